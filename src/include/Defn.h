@@ -696,10 +696,17 @@ SEXP ALTLOGICAL_SUM(SEXP x, Rboolean narm);
 
 /* constructors for internal ALTREP classes */
 SEXP R_compact_intrange(R_xlen_t n1, R_xlen_t n2);
+SEXP R_compact_cum(SEXP x, int op);
+SEXP R_rep_vector(SEXP x, R_xlen_t n, R_xlen_t each);
+SEXP R_subset_view(SEXP x, R_xlen_t first, R_xlen_t stride, R_xlen_t n);
+Rboolean R_compact_seq_info(SEXP x, R_xlen_t *n, double *n1, double *inc);
 SEXP R_deferred_coerceToString(SEXP v, SEXP info);
+SEXP R_deferred_arith(int code, SEXP x, SEXP y);
 SEXP R_virtrep_vec(SEXP, SEXP);
 SEXP R_tryWrap(SEXP);
 SEXP R_tryUnwrap(SEXP);
+SEXP R_wrap_unique(SEXP x, int srt, int no_na);
+Rboolean R_known_unique(SEXP x);
 
 Rboolean Rf_pmatch(SEXP, SEXP, Rboolean);
 Rboolean Rf_psmatch(const char *, const char *, Rboolean);
@@ -1382,6 +1389,13 @@ typedef enum {
     MATPROD_DEFAULT_SIMD  /* experimental */
 } MATPROD_TYPE;
 
+typedef enum {
+    SUMMATION_LDOUBLE = 1,
+    SUMMATION_DOUBLE,
+    SUMMATION_PAIRWISE,
+    SUMMATION_KAHAN
+} SUMMATION_TYPE;
+
 /* File Handling */
 /*
 #define R_EOF	65535
@@ -1457,6 +1471,14 @@ extern0 int	R_Expressions_keep INI_as(5000);/* options(expressions) */
 extern0 Rboolean R_KeepSource	INI_as(FALSE);	/* options(keep.source) */
 extern0 Rboolean R_CBoundsCheck	INI_as(FALSE);	/* options(CBoundsCheck) */
 extern0 MATPROD_TYPE R_Matprod	INI_as(MATPROD_DEFAULT);  /* options(matprod) */
+extern0 Rboolean R_DeferredArith INI_as(FALSE);	/* options(deferred.arith) */
+extern0 SUMMATION_TYPE R_Summation INI_as(SUMMATION_LDOUBLE); /* options(summation) */
+extern0 Rboolean R_BitsetLogical INI_as(FALSE);	/* options(bitset.logical) */
+extern0 Rboolean R_CollationKeys INI_as(FALSE);	/* options(collation.keys) */
+extern0 Rboolean R_HashIndex INI_as(FALSE);	/* options(hash.index) */
+extern0 Rboolean R_SubsetViews INI_as(FALSE);	/* options(subset.views) */
+extern0 Rboolean R_RepLazy INI_as(FALSE);	/* options(rep.lazy) */
+extern0 Rboolean R_ApplyThreads INI_as(TRUE);	/* options(apply.threads) */
 extern0 int	R_WarnLength	INI_as(1000);	/* Error/warning max length */
 extern0 int	R_nwarnings	INI_as(50);
 
@@ -2240,8 +2262,14 @@ int Rsnprintf_mbcs(char *str, size_t size, const char *format, ...);
 int Rasprintf_malloc(char **str, const char *fmt, ...);
 
 SEXP fixup_NaRm(SEXP args); /* summary.c */
+double R_rsum_array(const double *x, R_xlen_t n, Rboolean narm,
+		    R_xlen_t *cnt); /* summary.c */
 void invalidate_cached_recodings(void);  /* from sysutils.c */
 void resetICUcollator(Rboolean disable); /* from util.c */
+void R_resetCollationKeys(void); /* from util.c */
+void R_resetHashIndex(void); /* from unique.c */
+Rboolean R_lookupNameIndex(SEXP names, SEXP s, R_xlen_t *indx);
+SEXP R_MakeVectorWeakRef(SEXP key, SEXP val); /* from memory.c */
 void dt_invalidate_locale(void); /* from Rstrptime.h */
 extern int R_OutputCon; /* from connections.c */
 extern int R_InitReadItemDepth, R_ReadItemDepth; /* from serialize.c */
@@ -2268,6 +2296,10 @@ wchar_t *filenameToWchar(const SEXP fn, const Rboolean expand);
 FILE *RC_fopen(const SEXP fn, const char *mode, const Rboolean expand);
 int Seql(SEXP a, SEXP b);
 int Scollate(SEXP a, SEXP b);
+Rboolean R_useCollationKeys(void);
+SEXP R_CollationKey(SEXP a);
+int R_CollationKeyCmp(SEXP ka, SEXP kb);
+int ScollateKeys(SEXP a, SEXP b);
 
 double R_strtod4(const char *str, char **endptr, char dec, Rboolean NA);
 double R_strtod(const char *str, char **endptr);
@@ -147,6 +147,7 @@ SEXP do_dput(SEXP, SEXP, SEXP, SEXP);
 SEXP do_drop(SEXP, SEXP, SEXP, SEXP);
 SEXP do_dump(SEXP, SEXP, SEXP, SEXP);
 SEXP do_duplicated(SEXP, SEXP, SEXP, SEXP);
+SEXP do_grouprows(SEXP, SEXP, SEXP, SEXP);
 SEXP do_dynload(SEXP, SEXP, SEXP, SEXP);
 SEXP do_dynunload(SEXP, SEXP, SEXP, SEXP);
 SEXP do_eapply(SEXP, SEXP, SEXP, SEXP);
@@ -358,6 +359,7 @@ SEXP do_rgb(SEXP, SEXP, SEXP, SEXP);
 SEXP do_Rhome(SEXP, SEXP, SEXP, SEXP);
 SEXP do_RNGkind(SEXP, SEXP, SEXP, SEXP);
 SEXP do_rowsum(SEXP, SEXP, SEXP, SEXP);
+SEXP do_groupreduce(SEXP, SEXP, SEXP, SEXP);
 SEXP do_rowscols(SEXP, SEXP, SEXP, SEXP);
 SEXP do_S4on(SEXP, SEXP, SEXP, SEXP);
 SEXP do_sample(SEXP, SEXP, SEXP, SEXP);
@@ -26,6 +26,8 @@
 #include <float.h> /* for DBL_DIG */
 #include <Print.h> /* for R_print */
 #include <R_ext/Itermacros.h>
+#include "arithmetic.h" /* for R_POW */
+#include "bitset.h"
 
 #ifdef Win32
 #include <trioremap.h> /* for %lld */
@@ -373,8 +375,9 @@ static SEXP compact_realseq_Unserialize(SEXP class, SEXP state)
 static SEXP compact_realseq_Duplicate(SEXP x, Rboolean deep)
 {
     R_xlen_t n = XLENGTH(x);
-    SEXP val = allocVector(REALSXP, n);
+    SEXP val = PROTECT(allocVector(REALSXP, n));
     REAL_GET_REGION(x, 0, n, REAL0(val));
+    UNPROTECT(1);
     return val;
 }
 
@@ -586,6 +589,1178 @@ attribute_hidden SEXP R_compact_intrange(R_xlen_t n1, R_xlen_t n2)
 }
 
 
+/**
+ ** Cumulative Sums of Compact Sequences
+ **/
+
+/*
+ * Methods
+ */
+
+/* The state is a REALSXP holding the length, first element and
+   increment of the sequence and the number of elements that are not
+   NA: an integer cumulative sum is NA from the first overflow on. */
+#define COMPACT_CUMSUM_INFO(x) R_altrep_data1(x)
+#define COMPACT_CUMSUM_EXPANDED(x) R_altrep_data2(x)
+#define SET_COMPACT_CUMSUM_EXPANDED(x, v) R_set_altrep_data2(x, v)
+
+#define COMPACT_CUMSUM_INFO_LENGTH(info) ((R_xlen_t) REAL0(info)[0])
+#define COMPACT_CUMSUM_INFO_FIRST(info) ((int64_t) REAL0(info)[1])
+#define COMPACT_CUMSUM_INFO_INCR(info) ((int64_t) REAL0(info)[2])
+#define COMPACT_CUMSUM_INFO_NFINITE(info) ((R_xlen_t) REAL0(info)[3])
+
+/* element i, exact as the constructor ensures it is below 2^62 */
+static R_INLINE int64_t compact_cumsum_value(SEXP info, R_xlen_t i)
+{
+    int64_t n1 = COMPACT_CUMSUM_INFO_FIRST(info);
+    int64_t inc = COMPACT_CUMSUM_INFO_INCR(info);
+    return (i + 1) * n1 + inc * ((int64_t) i * (i + 1) / 2);
+}
+
+#define COMPACT_CUMSUM_FILL(info, i, n, buf, type, NA) do {		\
+	int64_t n1 = COMPACT_CUMSUM_INFO_FIRST(info);			\
+	int64_t inc = COMPACT_CUMSUM_INFO_INCR(info);			\
+	R_xlen_t nfin = COMPACT_CUMSUM_INFO_NFINITE(info);		\
+	R_xlen_t kfin = nfin - (i) > (n) ? (n) : nfin - (i);		\
+	int64_t v = (i) < nfin ? compact_cumsum_value(info, i) : 0;	\
+	R_xlen_t k = 0;							\
+	for (; k < kfin; k++) {						\
+	    buf[k] = (type) v;						\
+	    v += n1 + inc * ((i) + k + 1);				\
+	}								\
+	for (; k < (n); k++) buf[k] = NA;				\
+    } while (0)
+
+static R_altrep_class_t R_compact_intcumsum_class;
+static R_altrep_class_t R_compact_realcumsum_class;
+
+static SEXP new_compact_cumsum(R_altrep_class_t cls, SEXP info);
+
+static SEXP compact_cumsum_Duplicate(SEXP x, Rboolean deep)
+{
+    if (COMPACT_CUMSUM_EXPANDED(x) != R_NilValue)
+	return NULL; /* standard duplicate of the expanded data */
+    return new_compact_cumsum(TYPEOF(x) == INTSXP ?
+			      R_compact_intcumsum_class :
+			      R_compact_realcumsum_class,
+			      COMPACT_CUMSUM_INFO(x));
+}
+
+static
+Rboolean compact_cumsum_Inspect(SEXP x, int pre, int deep, int pvec,
+				void (*inspect_subtree)(SEXP, int, int, int))
+{
+    SEXP info = COMPACT_CUMSUM_INFO(x);
+    R_xlen_t n = COMPACT_CUMSUM_INFO_LENGTH(info);
+    double n1 = REAL0(info)[1];
+    double n2 = n1 + (n - 1) * REAL0(info)[2];
+    Rprintf(" cumsum(%.0f : %.0f) (%s)\n", n1, n2,
+	    COMPACT_CUMSUM_EXPANDED(x) == R_NilValue ? "compact" : "expanded");
+    return TRUE;
+}
+
+static R_xlen_t compact_cumsum_Length(SEXP x)
+{
+    return COMPACT_CUMSUM_INFO_LENGTH(COMPACT_CUMSUM_INFO(x));
+}
+
+static void *compact_cumsum_Dataptr(SEXP x, Rboolean writeable)
+{
+    if (COMPACT_CUMSUM_EXPANDED(x) == R_NilValue) {
+	PROTECT(x);
+	SEXP info = COMPACT_CUMSUM_INFO(x);
+	R_xlen_t n = COMPACT_CUMSUM_INFO_LENGTH(info);
+	SEXP val;
+	if (TYPEOF(x) == INTSXP) {
+	    val = allocVector(INTSXP, n);
+	    int *data = INTEGER(val);
+	    COMPACT_CUMSUM_FILL(info, 0, n, data, int, NA_INTEGER);
+	}
+	else {
+	    val = allocVector(REALSXP, n);
+	    double *data = REAL(val);
+	    COMPACT_CUMSUM_FILL(info, 0, n, data, double, NA_REAL);
+	}
+	SET_COMPACT_CUMSUM_EXPANDED(x, val);
+	UNPROTECT(1);
+    }
+    return DATAPTR(COMPACT_CUMSUM_EXPANDED(x));
+}
+
+static const void *compact_cumsum_Dataptr_or_null(SEXP x)
+{
+    SEXP val = COMPACT_CUMSUM_EXPANDED(x);
+    return val == R_NilValue ? NULL : DATAPTR(val);
+}
+
+static int compact_intcumsum_Elt(SEXP x, R_xlen_t i)
+{
+    SEXP ex = COMPACT_CUMSUM_EXPANDED(x);
+    if (ex != R_NilValue)
+	return INTEGER0(ex)[i];
+    SEXP info = COMPACT_CUMSUM_INFO(x);
+    return i < COMPACT_CUMSUM_INFO_NFINITE(info) ?
+	(int) compact_cumsum_value(info, i) : NA_INTEGER;
+}
+
+static double compact_realcumsum_Elt(SEXP x, R_xlen_t i)
+{
+    SEXP ex = COMPACT_CUMSUM_EXPANDED(x);
+    if (ex != R_NilValue)
+	return REAL0(ex)[i];
+    return (double) compact_cumsum_value(COMPACT_CUMSUM_INFO(x), i);
+}
+
+static R_xlen_t
+compact_intcumsum_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, int *buf)
+{
+    CHECK_NOT_EXPANDED(sx);
+    SEXP info = COMPACT_CUMSUM_INFO(sx);
+    R_xlen_t size = COMPACT_CUMSUM_INFO_LENGTH(info);
+    R_xlen_t ncopy = size - i > n ? n : size - i;
+    COMPACT_CUMSUM_FILL(info, i, ncopy, buf, int, NA_INTEGER);
+    return ncopy;
+}
+
+static R_xlen_t
+compact_realcumsum_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, double *buf)
+{
+    CHECK_NOT_EXPANDED(sx);
+    SEXP info = COMPACT_CUMSUM_INFO(sx);
+    R_xlen_t size = COMPACT_CUMSUM_INFO_LENGTH(info);
+    R_xlen_t ncopy = size - i > n ? n : size - i;
+    COMPACT_CUMSUM_FILL(info, i, ncopy, buf, double, NA_REAL);
+    return ncopy;
+}
+
+static int compact_cumsum_No_NA(SEXP x)
+{
+    SEXP info = COMPACT_CUMSUM_INFO(x);
+    return COMPACT_CUMSUM_INFO_NFINITE(info) == COMPACT_CUMSUM_INFO_LENGTH(info);
+}
+
+
+/*
+ * Class Objects and Method Tables
+ */
+
+static void InitCompactCumsumClasses(void)
+{
+    R_altrep_class_t cls = R_make_altinteger_class("compact_intcumsum",
+						   "base", NULL);
+    R_compact_intcumsum_class = cls;
+
+    /* override ALTREP methods */
+    R_set_altrep_Duplicate_method(cls, compact_cumsum_Duplicate);
+    R_set_altrep_Inspect_method(cls, compact_cumsum_Inspect);
+    R_set_altrep_Length_method(cls, compact_cumsum_Length);
+
+    /* override ALTVEC methods */
+    R_set_altvec_Dataptr_method(cls, compact_cumsum_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(cls, compact_cumsum_Dataptr_or_null);
+
+    /* override ALTINTEGER methods */
+    R_set_altinteger_Elt_method(cls, compact_intcumsum_Elt);
+    R_set_altinteger_Get_region_method(cls, compact_intcumsum_Get_region);
+    R_set_altinteger_No_NA_method(cls, compact_cumsum_No_NA);
+
+    cls = R_make_altreal_class("compact_realcumsum", "base", NULL);
+    R_compact_realcumsum_class = cls;
+
+    /* override ALTREP methods */
+    R_set_altrep_Duplicate_method(cls, compact_cumsum_Duplicate);
+    R_set_altrep_Inspect_method(cls, compact_cumsum_Inspect);
+    R_set_altrep_Length_method(cls, compact_cumsum_Length);
+
+    /* override ALTVEC methods */
+    R_set_altvec_Dataptr_method(cls, compact_cumsum_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(cls, compact_cumsum_Dataptr_or_null);
+
+    /* override ALTREAL methods */
+    R_set_altreal_Elt_method(cls, compact_realcumsum_Elt);
+    R_set_altreal_Get_region_method(cls, compact_realcumsum_Get_region);
+    R_set_altreal_No_NA_method(cls, compact_cumsum_No_NA);
+}
+
+
+/*
+ * Constructor
+ */
+
+static SEXP new_compact_cumsum(R_altrep_class_t cls, SEXP info)
+{
+    SEXP ans = R_new_altrep(cls, info, R_NilValue);
+    MARK_NOT_MUTABLE(ans); /* force duplicate on modify */
+    return ans;
+}
+
+/* cumsum(), cummax() or cummin() (op as in do_cum) of a compact
+   sequence without attributes, computed without expanding it, or NULL
+   to use the general code.  The cumulative sum is itself compact. */
+/* Do partial sums 1, ..., k of the integer sequence n1, n1 + inc, ...
+   leave the integer range?  Partial sum j is j * (2 * n1 + inc * (j - 1)) / 2,
+   a quadratic in j, so its largest absolute value for j <= k is at j = 1,
+   j = k or next to the vertex, at j = -inc * n1 or 1 - inc * n1. */
+static Rboolean compact_cumsum_overflows(int64_t n1, int64_t inc, int64_t k)
+{
+    int64_t jj[4] = {1, k, -inc * n1, 1 - inc * n1};
+    for (int l = 0; l < 4; l++) {
+	int64_t j = jj[l];
+	if (j < 1 || j > k) continue;
+	int64_t m = 2 * n1 + inc * (j - 1);
+	if (m < 0) m = -m;
+	/* |j * m / 2| > INT_MAX, without overflowing */
+	if (m > 0 && j > 2 * (int64_t) INT_MAX / m)
+	    return TRUE;
+    }
+    return FALSE;
+}
+
+/* Results shorter than this are computed by the general code. */
+#define COMPACT_CUM_MIN_N 1000
+
+attribute_hidden SEXP R_compact_cum(SEXP x, int op)
+{
+    Rboolean isint = R_altrep_inherits(x, R_compact_intseq_class);
+    if ((!isint && !R_altrep_inherits(x, R_compact_realseq_class)) ||
+	ATTRIB(x) != R_NilValue || XLENGTH(x) < COMPACT_CUM_MIN_N)
+	return NULL;
+#ifdef COMPACT_INTSEQ_MUTABLE
+    if (COMPACT_SEQ_EXPANDED(x) != R_NilValue)
+	return NULL;
+#endif
+    SEXP info = COMPACT_SEQ_INFO(x);
+    R_xlen_t n = (R_xlen_t) REAL0(info)[0];
+    double n1 = REAL0(info)[1], inc = REAL0(info)[2];
+
+    switch(op) {
+    case 3: /* cummax */
+    case 4: /* cummin */
+	if ((op == 3) == (inc > 0))
+	    return x; /* the sequence itself */
+	else {
+	    SEXP ans = allocVector(TYPEOF(x), n);
+	    if (isint) {
+		int *pa = INTEGER(ans);
+		for (R_xlen_t i = 0; i < n; i++) pa[i] = (int) n1;
+	    } else {
+		double *pa = REAL(ans);
+		for (R_xlen_t i = 0; i < n; i++) pa[i] = n1;
+	    }
+	    return ans;
+	}
+    case 1: /* cumsum */
+    {
+	/* A bound on the partial sums.  The general code adds in long
+	   double (exact for integers below 2^64 if it has a 64-bit
+	   mantissa) or double, so below that the closed form gives the
+	   same values. */
+	double bound = n * fabs(n1) + 0.5 * (double) n * n;
+	double exact = 0x1p53;
+#ifdef HAVE_LONG_DOUBLE
+	if (R_Summation == SUMMATION_LDOUBLE && LDBL_MANT_DIG >= 64)
+	    exact = 0x1p62;
+#endif
+	if (!isint && !(bound < exact && n1 == floor(n1)))
+	    return NULL;
+	R_xlen_t nfin = n;
+	if (isint && bound > INT_MAX &&
+	    compact_cumsum_overflows((int64_t) n1, (int64_t) inc, n)) {
+	    /* bisect for the first partial sum out of range */
+	    int64_t lo = 0, hi = n; /* sums 1..lo are in range, 1..hi not */
+	    while (hi - lo > 1) {
+		int64_t mid = lo + (hi - lo) / 2;
+		if (compact_cumsum_overflows((int64_t) n1, (int64_t) inc, mid))
+		    hi = mid;
+		else
+		    lo = mid;
+	    }
+	    warning(_("integer overflow in 'cumsum'; use 'cumsum(as.numeric(.))'"));
+	    nfin = (R_xlen_t) lo;
+	}
+	SEXP cinfo = allocVector(REALSXP, 4);
+	REAL0(cinfo)[0] = (double) n;
+	REAL0(cinfo)[1] = n1;
+	REAL0(cinfo)[2] = inc;
+	REAL0(cinfo)[3] = (double) nfin;
+	return new_compact_cumsum(isint ? R_compact_intcumsum_class :
+				  R_compact_realcumsum_class, cinfo);
+    }
+    default:
+	return NULL;
+    }
+}
+
+
+/**
+ ** Repeated Vectors
+ **/
+
+/*
+ * Methods
+ */
+
+/* The result of rep(x, each = each, length.out = n), element i being
+   x[(i / each) %% length(x)].  The state is CONS(x, info) with info a
+   REALSXP holding n and each; it is cleared when the vector is
+   expanded, which happens only when a data pointer is needed. */
+#define REPVEC_STATE(x) R_altrep_data1(x)
+#define CLEAR_REPVEC_STATE(x) R_set_altrep_data1(x, R_NilValue)
+#define REPVEC_EXPANDED(x) R_altrep_data2(x)
+#define SET_REPVEC_EXPANDED(x, v) R_set_altrep_data2(x, v)
+
+#define REPVEC_SOURCE(state) CAR(state)
+#define REPVEC_LENGTH(state) ((R_xlen_t) REAL0(CDR(state))[0])
+#define REPVEC_EACH(state) ((R_xlen_t) REAL0(CDR(state))[1])
+
+/* minimal length of a repeated vector; it must also be at least twice
+   as long as the source */
+#define REPVEC_MIN_N 65536
+
+static SEXP new_repvec(SEXP src, R_xlen_t n, R_xlen_t each);
+
+/* copy elements i, ..., i + ncopy - 1 into buf */
+#define REPVEC_FILL(state, i, ncopy, buf, ctype, vtype) do {		\
+	SEXP src = REPVEC_SOURCE(state);				\
+	R_xlen_t lx = XLENGTH(src), each = REPVEC_EACH(state);		\
+	R_xlen_t j = ((i) / each) % lx, r = each - (i) % each;		\
+	const ctype *ps = (const ctype *) DATAPTR_OR_NULL(src);	\
+	for (R_xlen_t k = 0; k < (ncopy); k++) {			\
+	    buf[k] = ps ? ps[j] : vtype##_ELT(src, j);			\
+	    if (--r == 0) {						\
+		r = each;						\
+		if (++j == lx) j = 0;					\
+	    }								\
+	}								\
+    } while (0)
+
+static R_INLINE R_xlen_t repvec_index(SEXP state, R_xlen_t i)
+{
+    return (i / REPVEC_EACH(state)) % XLENGTH(REPVEC_SOURCE(state));
+}
+
+static SEXP repvec_Duplicate(SEXP x, Rboolean deep)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue)
+	return NULL; /* standard duplicate of the expanded data */
+    return new_repvec(REPVEC_SOURCE(state), REPVEC_LENGTH(state),
+		      REPVEC_EACH(state));
+}
+
+static
+Rboolean repvec_Inspect(SEXP x, int pre, int deep, int pvec,
+			void (*inspect_subtree)(SEXP, int, int, int))
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue) {
+	Rprintf("  <expanded repeated vector>\n");
+	inspect_subtree(REPVEC_EXPANDED(x), pre, deep, pvec);
+    }
+    else {
+	Rprintf(" repeated to length %lld, each %lld\n",
+		(long long) REPVEC_LENGTH(state),
+		(long long) REPVEC_EACH(state));
+	inspect_subtree(REPVEC_SOURCE(state), pre, deep, pvec);
+    }
+    return TRUE;
+}
+
+static R_xlen_t repvec_Length(SEXP x)
+{
+    SEXP state = REPVEC_STATE(x);
+    return state == R_NilValue ?
+	XLENGTH(REPVEC_EXPANDED(x)) : REPVEC_LENGTH(state);
+}
+
+static void *repvec_Dataptr(SEXP x, Rboolean writeable)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state != R_NilValue) {
+	PROTECT(x);
+	R_xlen_t n = REPVEC_LENGTH(state);
+	R_xlen_t period = XLENGTH(REPVEC_SOURCE(state)) * REPVEC_EACH(state);
+	R_xlen_t np = period < n ? period : n;
+	SEXP val = PROTECT(allocVector(TYPEOF(x), n));
+	switch(TYPEOF(x)) {
+	case LGLSXP:
+	{
+	    int *pv = LOGICAL0(val);
+	    REPVEC_FILL(state, 0, np, pv, int, LOGICAL);
+	    break;
+	}
+	case INTSXP:
+	{
+	    int *pv = INTEGER0(val);
+	    REPVEC_FILL(state, 0, np, pv, int, INTEGER);
+	    break;
+	}
+	case REALSXP:
+	{
+	    double *pv = REAL0(val);
+	    REPVEC_FILL(state, 0, np, pv, double, REAL);
+	    break;
+	}
+	case STRSXP:
+	{
+	    SEXP src = REPVEC_SOURCE(state);
+	    for (R_xlen_t i = 0; i < n; i++)
+		SET_STRING_ELT(val, i, STRING_ELT(src, repvec_index(state, i)));
+	    break;
+	}
+	default:
+	    error("unsupported type for a repeated vector");
+	}
+	if (TYPEOF(x) != STRSXP) {
+	    /* the rest is copies of the first period, in doubling blocks */
+	    char *pv = (char *) DATAPTR(val);
+	    size_t size = TYPEOF(x) == REALSXP ? sizeof(double) : sizeof(int);
+	    for (R_xlen_t done = np; done < n; ) {
+		R_xlen_t ncopy = done < n - done ? done : n - done;
+		memcpy(pv + done * size, pv, ncopy * size);
+		done += ncopy;
+	    }
+	}
+	SET_REPVEC_EXPANDED(x, val);
+	CLEAR_REPVEC_STATE(x); /* allow the source to be reclaimed */
+	UNPROTECT(2);
+    }
+    return DATAPTR(REPVEC_EXPANDED(x));
+}
+
+static const void *repvec_Dataptr_or_null(SEXP x)
+{
+    return REPVEC_STATE(x) != R_NilValue ? NULL :
+	DATAPTR(REPVEC_EXPANDED(x));
+}
+
+/* Subsetting maps the subscripts to the source, whose ExtractSubset
+   then gives NA for out-of-bounds subscripts. */
+static SEXP repvec_Extract_subset(SEXP x, SEXP indx, SEXP call)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue)
+	return NULL;
+    R_xlen_t n = REPVEC_LENGTH(state), ni = XLENGTH(indx);
+    SEXP sindx;
+    if (TYPEOF(indx) == INTSXP) {
+	const int *pi = INTEGER_RO(indx);
+	PROTECT(sindx = allocVector(INTSXP, ni));
+	int *ps = INTEGER0(sindx);
+	for (R_xlen_t k = 0; k < ni; k++) {
+	    int ii = pi[k];
+	    ps[k] = (0 < ii && ii <= n) ?
+		(int) repvec_index(state, ii - 1) + 1 : NA_INTEGER;
+	}
+    }
+    else if (TYPEOF(indx) == REALSXP) {
+	const double *pi = REAL_RO(indx);
+	PROTECT(sindx = allocVector(REALSXP, ni));
+	double *ps = REAL0(sindx);
+	for (R_xlen_t k = 0; k < ni; k++) {
+	    double di = pi[k];
+	    R_xlen_t ii = (R_xlen_t) (di - 1);
+	    ps[k] = (R_FINITE(di) && 0 <= ii && ii < n) ?
+		(double) repvec_index(state, ii) + 1 : NA_REAL;
+	}
+    }
+    else return NULL;
+    SEXP ans = ExtractSubset(REPVEC_SOURCE(state), sindx, call);
+    UNPROTECT(1); /* sindx */
+    return ans;
+}
+
+/* number of copies of source element j */
+static R_INLINE R_xlen_t repvec_count(SEXP state, R_xlen_t j)
+{
+    R_xlen_t each = REPVEC_EACH(state);
+    R_xlen_t period = XLENGTH(REPVEC_SOURCE(state)) * each;
+    R_xlen_t rest = REPVEC_LENGTH(state) % period - j * each;
+    return (REPVEC_LENGTH(state) / period) * each +
+	(rest < 0 ? 0 : (rest > each ? each : rest));
+}
+
+/* integer (and logical) sums are exact, and left to the standard
+   code (which signals overflow) if they do not fit an integer */
+static SEXP repvec_isum(SEXP x, Rboolean narm)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue)
+	return NULL;
+    SEXP src = REPVEC_SOURCE(state);
+    R_xlen_t lx = XLENGTH(src);
+    LDOUBLE s = 0.0;
+    for (R_xlen_t j = 0; j < lx; j++) {
+	R_xlen_t cnt = repvec_count(state, j);
+	if (cnt == 0) break;
+	int v = TYPEOF(src) == LGLSXP ? LOGICAL_ELT(src, j) :
+	    INTEGER_ELT(src, j);
+	if (v == NA_INTEGER) {
+	    if (!narm) return ScalarInteger(NA_INTEGER);
+	}
+	else s += (LDOUBLE) cnt * v;
+    }
+    if (s > INT_MAX || s < R_INT_MIN)
+	return NULL;
+    return ScalarInteger((int) s);
+}
+
+/* real sums are only done here when exact, so equal to the standard
+   ones: for integer values with all partial sums below 2^53 */
+static SEXP repvec_rsum(SEXP x, Rboolean narm)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue)
+	return NULL;
+    SEXP src = REPVEC_SOURCE(state);
+    R_xlen_t lx = XLENGTH(src);
+    double bound = 0.0, s = 0.0;
+    for (R_xlen_t j = 0; j < lx; j++) {
+	R_xlen_t cnt = repvec_count(state, j);
+	if (cnt == 0) break;
+	double v = REAL_ELT(src, j);
+	if (!R_FINITE(v) || v != floor(v))
+	    return NULL;
+	bound += cnt * fabs(v);
+	s += cnt * v;
+    }
+    return bound < 0x1p53 ? ScalarReal(s) : NULL;
+}
+
+/* A prefix of a sorted source stays sorted when repeated, but not
+   when recycled. */
+static int repvec_Is_sorted(SEXP x)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue)
+	return UNKNOWN_SORTEDNESS;
+    SEXP src = REPVEC_SOURCE(state);
+    R_xlen_t lx = XLENGTH(src);
+    if (REPVEC_LENGTH(state) > lx * REPVEC_EACH(state))
+	return lx == 1 ? SORTED_INCR : UNKNOWN_SORTEDNESS;
+    switch(TYPEOF(src)) {
+    case INTSXP: return INTEGER_IS_SORTED(src);
+    case REALSXP: return REAL_IS_SORTED(src);
+    default: return UNKNOWN_SORTEDNESS;
+    }
+}
+
+static int repvec_No_NA(SEXP x)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue)
+	return FALSE; /* the expanded data may have been modified */
+    SEXP src = REPVEC_SOURCE(state);
+    switch(TYPEOF(src)) {
+    case LGLSXP: return LOGICAL_NO_NA(src);
+    case INTSXP: return INTEGER_NO_NA(src);
+    case REALSXP: return REAL_NO_NA(src);
+    case STRSXP: return STRING_NO_NA(src);
+    default: return FALSE;
+    }
+}
+
+#define REPVEC_ELT(x, i, vtype) do {					\
+	SEXP state = REPVEC_STATE(x);					\
+	if (state == R_NilValue)					\
+	    return vtype##0(REPVEC_EXPANDED(x))[i];			\
+	return vtype##_ELT(REPVEC_SOURCE(state), repvec_index(state, i)); \
+    } while (0)
+
+static int repvec_logical_Elt(SEXP x, R_xlen_t i)
+{
+    REPVEC_ELT(x, i, LOGICAL);
+}
+
+static int repvec_integer_Elt(SEXP x, R_xlen_t i)
+{
+    REPVEC_ELT(x, i, INTEGER);
+}
+
+static double repvec_real_Elt(SEXP x, R_xlen_t i)
+{
+    REPVEC_ELT(x, i, REAL);
+}
+
+static SEXP repvec_string_Elt(SEXP x, R_xlen_t i)
+{
+    SEXP state = REPVEC_STATE(x);
+    if (state == R_NilValue)
+	return STRING_ELT(REPVEC_EXPANDED(x), i);
+    return STRING_ELT(REPVEC_SOURCE(state), repvec_index(state, i));
+}
+
+static void repvec_string_Set_elt(SEXP x, R_xlen_t i, SEXP v)
+{
+    repvec_Dataptr(x, TRUE);
+    SET_STRING_ELT(REPVEC_EXPANDED(x), i, v);
+}
+
+#define REPVEC_GET_REGION(sx, i, n, buf, ctype, vtype) do {		\
+	CHECK_NOT_EXPANDED(sx);						\
+	SEXP state = REPVEC_STATE(sx);					\
+	R_xlen_t size = REPVEC_LENGTH(state);				\
+	R_xlen_t ncopy = size - i > n ? n : size - i;			\
+	REPVEC_FILL(state, i, ncopy, buf, ctype, vtype);		\
+	return ncopy;							\
+    } while (0)
+
+static R_xlen_t
+repvec_logical_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, int *buf)
+{
+    REPVEC_GET_REGION(sx, i, n, buf, int, LOGICAL);
+}
+
+static R_xlen_t
+repvec_integer_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, int *buf)
+{
+    REPVEC_GET_REGION(sx, i, n, buf, int, INTEGER);
+}
+
+static R_xlen_t
+repvec_real_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, double *buf)
+{
+    REPVEC_GET_REGION(sx, i, n, buf, double, REAL);
+}
+
+
+/*
+ * Class Objects and Method Tables
+ */
+
+static R_altrep_class_t repvec_logical_class;
+static R_altrep_class_t repvec_integer_class;
+static R_altrep_class_t repvec_real_class;
+static R_altrep_class_t repvec_string_class;
+
+static void InitRepvecMethods(R_altrep_class_t cls)
+{
+    /* override ALTREP methods */
+    R_set_altrep_Duplicate_method(cls, repvec_Duplicate);
+    R_set_altrep_Inspect_method(cls, repvec_Inspect);
+    R_set_altrep_Length_method(cls, repvec_Length);
+
+    /* override ALTVEC methods */
+    R_set_altvec_Dataptr_method(cls, repvec_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(cls, repvec_Dataptr_or_null);
+    R_set_altvec_Extract_subset_method(cls, repvec_Extract_subset);
+}
+
+static void InitRepvecClasses(void)
+{
+    R_altrep_class_t cls;
+
+    cls = R_make_altlogical_class("rep_logical", "base", NULL);
+    repvec_logical_class = cls;
+    InitRepvecMethods(cls);
+    R_set_altlogical_Elt_method(cls, repvec_logical_Elt);
+    R_set_altlogical_Get_region_method(cls, repvec_logical_Get_region);
+    R_set_altlogical_No_NA_method(cls, repvec_No_NA);
+    R_set_altlogical_Sum_method(cls, repvec_isum);
+
+    cls = R_make_altinteger_class("rep_integer", "base", NULL);
+    repvec_integer_class = cls;
+    InitRepvecMethods(cls);
+    R_set_altinteger_Elt_method(cls, repvec_integer_Elt);
+    R_set_altinteger_Get_region_method(cls, repvec_integer_Get_region);
+    R_set_altinteger_Is_sorted_method(cls, repvec_Is_sorted);
+    R_set_altinteger_No_NA_method(cls, repvec_No_NA);
+    R_set_altinteger_Sum_method(cls, repvec_isum);
+
+    cls = R_make_altreal_class("rep_real", "base", NULL);
+    repvec_real_class = cls;
+    InitRepvecMethods(cls);
+    R_set_altreal_Elt_method(cls, repvec_real_Elt);
+    R_set_altreal_Get_region_method(cls, repvec_real_Get_region);
+    R_set_altreal_Is_sorted_method(cls, repvec_Is_sorted);
+    R_set_altreal_No_NA_method(cls, repvec_No_NA);
+    R_set_altreal_Sum_method(cls, repvec_rsum);
+
+    cls = R_make_altstring_class("rep_string", "base", NULL);
+    repvec_string_class = cls;
+    InitRepvecMethods(cls);
+    R_set_altstring_Elt_method(cls, repvec_string_Elt);
+    R_set_altstring_Set_elt_method(cls, repvec_string_Set_elt);
+    R_set_altstring_No_NA_method(cls, repvec_No_NA);
+}
+
+
+/*
+ * Constructor
+ */
+
+static SEXP new_repvec(SEXP src, R_xlen_t n, R_xlen_t each)
+{
+    R_altrep_class_t cls;
+    switch(TYPEOF(src)) {
+    case LGLSXP: cls = repvec_logical_class; break;
+    case INTSXP: cls = repvec_integer_class; break;
+    case REALSXP: cls = repvec_real_class; break;
+    case STRSXP: cls = repvec_string_class; break;
+    default: error("unsupported type for a repeated vector");
+    }
+    SEXP info = PROTECT(allocVector(REALSXP, 2));
+    REAL0(info)[0] = (double) n;
+    REAL0(info)[1] = (double) each;
+    MARK_NOT_MUTABLE(src); /* the source must not change */
+    SEXP state = PROTECT(CONS(src, info));
+    SEXP ans = R_new_altrep(cls, state, R_NilValue);
+    MARK_NOT_MUTABLE(ans); /* force duplicate on modify */
+    UNPROTECT(2);
+    return ans;
+}
+
+/* rep(x, each = each, length.out = n) as a repeated vector, or NULL
+   if options(rep.lazy) is false, it is short or x is not a logical,
+   integer, real or character vector.  Only the values of x are used,
+   not its attributes. */
+attribute_hidden SEXP R_rep_vector(SEXP x, R_xlen_t n, R_xlen_t each)
+{
+    R_xlen_t lx = XLENGTH(x);
+    if (!R_RepLazy || n < REPVEC_MIN_N || n / 2 < lx || lx == 0 || each < 1 ||
+	(double) lx * each > R_XLEN_T_MAX)
+	return NULL;
+    switch(TYPEOF(x)) {
+    case LGLSXP:
+    case INTSXP:
+    case REALSXP:
+    case STRSXP:
+	break;
+    default:
+	return NULL;
+    }
+    return new_repvec(x, n, each);
+}
+
+
+/**
+ ** Subset Views
+ **/
+
+/*
+ * Methods
+ */
+
+/* Elements first, first + stride, ... (0-based) of a source vector, as
+   created for x[i] and m[i, j] with arithmetic subscripts when
+   options(subset.views) is true.  The state is CONS(x, info) with info
+   a REALSXP holding the length, first and stride.  The source is
+   marked not mutable, so it is copied rather than modified while the
+   view exists.  Contiguous views give read-only data pointers into the
+   source; the data are copied when a writeable pointer is needed.  The
+   state is kept then, as read-only pointers may still be in use. */
+#define VIEW_STATE(x) R_altrep_data1(x)
+#define VIEW_EXPANDED(x) R_altrep_data2(x)
+#define SET_VIEW_EXPANDED(x, v) R_set_altrep_data2(x, v)
+
+#define VIEW_SOURCE(state) CAR(state)
+#define VIEW_LENGTH(state) ((R_xlen_t) REAL0(CDR(state))[0])
+#define VIEW_FIRST(state) ((R_xlen_t) REAL0(CDR(state))[1])
+#define VIEW_STRIDE(state) ((R_xlen_t) REAL0(CDR(state))[2])
+#define VIEW_INDEX(state, i) (VIEW_FIRST(state) + (i) * VIEW_STRIDE(state))
+
+static SEXP new_view(SEXP src, R_xlen_t n, R_xlen_t first, R_xlen_t stride);
+
+/* copy elements i, ..., i + ncopy - 1 into buf */
+#define VIEW_FILL(state, i, ncopy, buf, ctype, vtype) do {		\
+	SEXP src = VIEW_SOURCE(state);					\
+	R_xlen_t stride = VIEW_STRIDE(state), j = VIEW_INDEX(state, i);	\
+	const ctype *ps = (const ctype *) DATAPTR_OR_NULL(src);	\
+	if (ps != NULL && stride == 1)					\
+	    memcpy(buf, ps + j, (ncopy) * sizeof(ctype));		\
+	else								\
+	    for (R_xlen_t k = 0; k < (ncopy); k++, j += stride)	\
+		buf[k] = ps ? ps[j] : vtype##_ELT(src, j);		\
+    } while (0)
+
+static size_t view_eltsize(SEXP x)
+{
+    switch(TYPEOF(x)) {
+    case LGLSXP:
+    case INTSXP: return sizeof(int);
+    case REALSXP: return sizeof(double);
+    case CPLXSXP: return sizeof(Rcomplex);
+    default: return sizeof(SEXP);
+    }
+}
+
+static SEXP view_Duplicate(SEXP x, Rboolean deep)
+{
+    if (VIEW_EXPANDED(x) != R_NilValue)
+	return NULL; /* standard duplicate of the expanded data */
+    SEXP state = VIEW_STATE(x);
+    return new_view(VIEW_SOURCE(state), VIEW_LENGTH(state),
+		    VIEW_FIRST(state), VIEW_STRIDE(state));
+}
+
+static
+Rboolean view_Inspect(SEXP x, int pre, int deep, int pvec,
+		      void (*inspect_subtree)(SEXP, int, int, int))
+{
+    SEXP state = VIEW_STATE(x);
+    if (VIEW_EXPANDED(x) != R_NilValue) {
+	Rprintf("  <expanded view>\n");
+	inspect_subtree(VIEW_EXPANDED(x), pre, deep, pvec);
+    }
+    else {
+	Rprintf(" view of length %lld, first %lld, stride %lld\n",
+		(long long) VIEW_LENGTH(state),
+		(long long) VIEW_FIRST(state) + 1,
+		(long long) VIEW_STRIDE(state));
+	inspect_subtree(VIEW_SOURCE(state), pre, deep, pvec);
+    }
+    return TRUE;
+}
+
+static R_xlen_t view_Length(SEXP x)
+{
+    return VIEW_LENGTH(VIEW_STATE(x));
+}
+
+/* a read-only pointer into the source for a contiguous view, or NULL */
+static const void *view_source_ptr(SEXP state)
+{
+    if (VIEW_STRIDE(state) != 1)
+	return NULL;
+    SEXP src = VIEW_SOURCE(state);
+    const char *ps = DATAPTR_OR_NULL(src);
+    return ps == NULL ? NULL : ps + VIEW_FIRST(state) * view_eltsize(src);
+}
+
+static void *view_Dataptr(SEXP x, Rboolean writeable)
+{
+    SEXP state = VIEW_STATE(x);
+    if (VIEW_EXPANDED(x) == R_NilValue) {
+	const void *p;
+	if (!writeable && (p = view_source_ptr(state)) != NULL)
+	    return (void *) p;
+	PROTECT(x);
+	R_xlen_t n = VIEW_LENGTH(state);
+	SEXP val = PROTECT(allocVector(TYPEOF(x), n));
+	switch(TYPEOF(x)) {
+	case LGLSXP:
+	{
+	    int *pv = LOGICAL0(val);
+	    VIEW_FILL(state, 0, n, pv, int, LOGICAL);
+	    break;
+	}
+	case INTSXP:
+	{
+	    int *pv = INTEGER0(val);
+	    VIEW_FILL(state, 0, n, pv, int, INTEGER);
+	    break;
+	}
+	case REALSXP:
+	{
+	    double *pv = REAL0(val);
+	    VIEW_FILL(state, 0, n, pv, double, REAL);
+	    break;
+	}
+	case CPLXSXP:
+	{
+	    Rcomplex *pv = COMPLEX0(val);
+	    VIEW_FILL(state, 0, n, pv, Rcomplex, COMPLEX);
+	    break;
+	}
+	case STRSXP:
+	{
+	    SEXP src = VIEW_SOURCE(state);
+	    for (R_xlen_t i = 0; i < n; i++)
+		SET_STRING_ELT(val, i, STRING_ELT(src, VIEW_INDEX(state, i)));
+	    break;
+	}
+	default:
+	    error("unsupported type for a subset view");
+	}
+	SET_VIEW_EXPANDED(x, val);
+	UNPROTECT(2);
+    }
+    return DATAPTR(VIEW_EXPANDED(x));
+}
+
+static const void *view_Dataptr_or_null(SEXP x)
+{
+    if (VIEW_EXPANDED(x) != R_NilValue)
+	return DATAPTR(VIEW_EXPANDED(x));
+    return view_source_ptr(VIEW_STATE(x));
+}
+
+/* Subsetting maps the subscripts to the source, whose ExtractSubset
+   then gives NA for out-of-bounds subscripts (and a view for
+   arithmetic ones). */
+static SEXP view_Extract_subset(SEXP x, SEXP indx, SEXP call)
+{
+    if (VIEW_EXPANDED(x) != R_NilValue)
+	return NULL;
+    SEXP state = VIEW_STATE(x);
+    R_xlen_t n = VIEW_LENGTH(state), ni = XLENGTH(indx);
+    SEXP sindx;
+    if (TYPEOF(indx) == INTSXP) {
+	const int *pi = INTEGER_RO(indx);
+	PROTECT(sindx = allocVector(REALSXP, ni));
+	double *ps = REAL0(sindx);
+	for (R_xlen_t k = 0; k < ni; k++) {
+	    int ii = pi[k];
+	    ps[k] = (0 < ii && ii <= n) ?
+		(double) VIEW_INDEX(state, ii - 1) + 1 : NA_REAL;
+	}
+    }
+    else if (TYPEOF(indx) == REALSXP) {
+	const double *pi = REAL_RO(indx);
+	PROTECT(sindx = allocVector(REALSXP, ni));
+	double *ps = REAL0(sindx);
+	for (R_xlen_t k = 0; k < ni; k++) {
+	    double di = pi[k];
+	    R_xlen_t ii = (R_xlen_t) (di - 1);
+	    ps[k] = (R_FINITE(di) && 0 <= ii && ii < n) ?
+		(double) VIEW_INDEX(state, ii) + 1 : NA_REAL;
+	}
+    }
+    else return NULL;
+    SEXP ans = ExtractSubset(VIEW_SOURCE(state), sindx, call);
+    UNPROTECT(1); /* sindx */
+    return ans;
+}
+
+static int view_Is_sorted(SEXP x)
+{
+    if (VIEW_EXPANDED(x) != R_NilValue)
+	return UNKNOWN_SORTEDNESS;
+    SEXP src = VIEW_SOURCE(VIEW_STATE(x));
+    switch(TYPEOF(src)) {
+    case INTSXP: return INTEGER_IS_SORTED(src);
+    case REALSXP: return REAL_IS_SORTED(src);
+    default: return UNKNOWN_SORTEDNESS;
+    }
+}
+
+static int view_No_NA(SEXP x)
+{
+    if (VIEW_EXPANDED(x) != R_NilValue)
+	return FALSE; /* the expanded data may have been modified */
+    SEXP src = VIEW_SOURCE(VIEW_STATE(x));
+    switch(TYPEOF(src)) {
+    case LGLSXP: return LOGICAL_NO_NA(src);
+    case INTSXP: return INTEGER_NO_NA(src);
+    case REALSXP: return REAL_NO_NA(src);
+    case STRSXP: return STRING_NO_NA(src);
+    default: return FALSE;
+    }
+}
+
+#define VIEW_ELT(x, i, vtype) do {					\
+	if (VIEW_EXPANDED(x) != R_NilValue)				\
+	    return vtype##0(VIEW_EXPANDED(x))[i];			\
+	SEXP state = VIEW_STATE(x);					\
+	return vtype##_ELT(VIEW_SOURCE(state), VIEW_INDEX(state, i));	\
+    } while (0)
+
+static int view_logical_Elt(SEXP x, R_xlen_t i)
+{
+    VIEW_ELT(x, i, LOGICAL);
+}
+
+static int view_integer_Elt(SEXP x, R_xlen_t i)
+{
+    VIEW_ELT(x, i, INTEGER);
+}
+
+static double view_real_Elt(SEXP x, R_xlen_t i)
+{
+    VIEW_ELT(x, i, REAL);
+}
+
+static Rcomplex view_complex_Elt(SEXP x, R_xlen_t i)
+{
+    VIEW_ELT(x, i, COMPLEX);
+}
+
+static SEXP view_string_Elt(SEXP x, R_xlen_t i)
+{
+    if (VIEW_EXPANDED(x) != R_NilValue)
+	return STRING_ELT(VIEW_EXPANDED(x), i);
+    SEXP state = VIEW_STATE(x);
+    return STRING_ELT(VIEW_SOURCE(state), VIEW_INDEX(state, i));
+}
+
+static void view_string_Set_elt(SEXP x, R_xlen_t i, SEXP v)
+{
+    view_Dataptr(x, TRUE);
+    SET_STRING_ELT(VIEW_EXPANDED(x), i, v);
+}
+
+#define VIEW_GET_REGION(sx, i, n, buf, ctype, vtype) do {		\
+	if (VIEW_EXPANDED(sx) != R_NilValue)				\
+	    return vtype##_GET_REGION(VIEW_EXPANDED(sx), i, n, buf);	\
+	SEXP state = VIEW_STATE(sx);					\
+	R_xlen_t size = VIEW_LENGTH(state);				\
+	R_xlen_t ncopy = size - i > n ? n : size - i;			\
+	VIEW_FILL(state, i, ncopy, buf, ctype, vtype);			\
+	return ncopy;							\
+    } while (0)
+
+static R_xlen_t
+view_logical_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, int *buf)
+{
+    VIEW_GET_REGION(sx, i, n, buf, int, LOGICAL);
+}
+
+static R_xlen_t
+view_integer_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, int *buf)
+{
+    VIEW_GET_REGION(sx, i, n, buf, int, INTEGER);
+}
+
+static R_xlen_t
+view_real_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, double *buf)
+{
+    VIEW_GET_REGION(sx, i, n, buf, double, REAL);
+}
+
+static R_xlen_t
+view_complex_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, Rcomplex *buf)
+{
+    VIEW_GET_REGION(sx, i, n, buf, Rcomplex, COMPLEX);
+}
+
+
+/*
+ * Class Objects and Method Tables
+ */
+
+static R_altrep_class_t view_logical_class;
+static R_altrep_class_t view_integer_class;
+static R_altrep_class_t view_real_class;
+static R_altrep_class_t view_complex_class;
+static R_altrep_class_t view_string_class;
+
+static void InitViewMethods(R_altrep_class_t cls)
+{
+    /* override ALTREP methods */
+    R_set_altrep_Duplicate_method(cls, view_Duplicate);
+    R_set_altrep_Inspect_method(cls, view_Inspect);
+    R_set_altrep_Length_method(cls, view_Length);
+
+    /* override ALTVEC methods */
+    R_set_altvec_Dataptr_method(cls, view_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(cls, view_Dataptr_or_null);
+    R_set_altvec_Extract_subset_method(cls, view_Extract_subset);
+}
+
+static void InitViewClasses(void)
+{
+    R_altrep_class_t cls;
+
+    cls = R_make_altlogical_class("view_logical", "base", NULL);
+    view_logical_class = cls;
+    InitViewMethods(cls);
+    R_set_altlogical_Elt_method(cls, view_logical_Elt);
+    R_set_altlogical_Get_region_method(cls, view_logical_Get_region);
+    R_set_altlogical_No_NA_method(cls, view_No_NA);
+
+    cls = R_make_altinteger_class("view_integer", "base", NULL);
+    view_integer_class = cls;
+    InitViewMethods(cls);
+    R_set_altinteger_Elt_method(cls, view_integer_Elt);
+    R_set_altinteger_Get_region_method(cls, view_integer_Get_region);
+    R_set_altinteger_Is_sorted_method(cls, view_Is_sorted);
+    R_set_altinteger_No_NA_method(cls, view_No_NA);
+
+    cls = R_make_altreal_class("view_real", "base", NULL);
+    view_real_class = cls;
+    InitViewMethods(cls);
+    R_set_altreal_Elt_method(cls, view_real_Elt);
+    R_set_altreal_Get_region_method(cls, view_real_Get_region);
+    R_set_altreal_Is_sorted_method(cls, view_Is_sorted);
+    R_set_altreal_No_NA_method(cls, view_No_NA);
+
+    cls = R_make_altcomplex_class("view_complex", "base", NULL);
+    view_complex_class = cls;
+    InitViewMethods(cls);
+    R_set_altcomplex_Elt_method(cls, view_complex_Elt);
+    R_set_altcomplex_Get_region_method(cls, view_complex_Get_region);
+
+    cls = R_make_altstring_class("view_string", "base", NULL);
+    view_string_class = cls;
+    InitViewMethods(cls);
+    R_set_altstring_Elt_method(cls, view_string_Elt);
+    R_set_altstring_Set_elt_method(cls, view_string_Set_elt);
+    R_set_altstring_No_NA_method(cls, view_No_NA);
+}
+
+
+/*
+ * Constructor
+ */
+
+static R_altrep_class_t *view_class(SEXPTYPE type)
+{
+    switch(type) {
+    case LGLSXP: return &view_logical_class;
+    case INTSXP: return &view_integer_class;
+    case REALSXP: return &view_real_class;
+    case CPLXSXP: return &view_complex_class;
+    case STRSXP: return &view_string_class;
+    default: return NULL;
+    }
+}
+
+static SEXP new_view(SEXP src, R_xlen_t n, R_xlen_t first, R_xlen_t stride)
+{
+    R_altrep_class_t *cls = view_class(TYPEOF(src));
+    if (cls == NULL)
+	error("unsupported type for a subset view");
+    SEXP info = PROTECT(allocVector(REALSXP, 3));
+    REAL0(info)[0] = (double) n;
+    REAL0(info)[1] = (double) first;
+    REAL0(info)[2] = (double) stride;
+    MARK_NOT_MUTABLE(src); /* the source must not change */
+    SEXP state = PROTECT(CONS(src, info));
+    SEXP ans = R_new_altrep(*cls, state, R_NilValue);
+    UNPROTECT(2);
+    return ans;
+}
+
+/* A view of the n elements first, first + stride, ... (0-based) of x,
+   which must exist, or NULL if x is not a logical, integer, real,
+   complex or character vector.  Views of unexpanded views refer to
+   their source.  Only the values of x are used, not its attributes. */
+attribute_hidden SEXP R_subset_view(SEXP x, R_xlen_t first, R_xlen_t stride,
+				    R_xlen_t n)
+{
+    R_altrep_class_t *cls = view_class(TYPEOF(x));
+    if (cls == NULL)
+	return NULL;
+    if (ALTREP(x) && R_altrep_inherits(x, *cls) &&
+	VIEW_EXPANDED(x) == R_NilValue) {
+	SEXP state = VIEW_STATE(x);
+	first = VIEW_INDEX(state, first);
+	stride *= VIEW_STRIDE(state);
+	x = VIEW_SOURCE(state);
+    }
+    return new_view(x, n, first, stride);
+}
+
+/* If x is a compact integer or real sequence, set its length, first
+   element and increment and return TRUE. */
+attribute_hidden Rboolean R_compact_seq_info(SEXP x, R_xlen_t *n,
+					     double *n1, double *inc)
+{
+    if (!ALTREP(x) || !(R_altrep_inherits(x, R_compact_intseq_class) ||
+			R_altrep_inherits(x, R_compact_realseq_class)))
+	return FALSE;
+#ifdef COMPACT_INTSEQ_MUTABLE
+    if (COMPACT_SEQ_EXPANDED(x) != R_NilValue)
+	return FALSE;
+#endif
+    SEXP info = COMPACT_SEQ_INFO(x);
+    *n = (R_xlen_t) REAL0(info)[0];
+    *n1 = REAL0(info)[1];
+    *inc = REAL0(info)[2];
+    return TRUE;
+}
+
+
 /**
  ** Deferred String Coercions
  **/
@@ -898,6 +2073,489 @@ attribute_hidden SEXP R_deferred_coerceToString(SEXP v, SEXP info)
 }
 
 
+/**
+ ** Deferred Arithmetic
+ **/
+
+/* With options(deferred.arith = TRUE) the arithmetic operators on
+   long plain double vectors return a deferred_arith object holding
+   the operator and its operands instead of computing the result.  The
+   operands can themselves be deferred, so an expression like a * b +
+   c * d - e builds a tree of these objects.  Get_region evaluates a
+   tree in blocks which fit in cache, with the intermediate values in
+   block-sized buffers on the stack, so sum() and the like, which
+   iterate by region, never allocate a full length temporary; the
+   DATAPTR method fills a single result vector in the same way and
+   then releases the operands.  Each element is computed by the same
+   arithmetic as in real_binary(), so the results are identical. */
+
+/*
+ * Methods
+ */
+
+#define DEFERRED_ARITH_STATE(x) R_altrep_data1(x)
+#define	CLEAR_DEFERRED_ARITH_STATE(x) R_set_altrep_data1(x, R_NilValue)
+#define DEFERRED_ARITH_EXPANDED(x) R_altrep_data2(x)
+#define SET_DEFERRED_ARITH_EXPANDED(x, v) R_set_altrep_data2(x, v)
+
+#define MAKE_DEFERRED_ARITH_STATE(x, y, info) CONS(x, CONS(y, info))
+#define DEFERRED_ARITH_STATE_X(s) CAR(s)
+#define DEFERRED_ARITH_STATE_Y(s) CADR(s)
+#define DEFERRED_ARITH_STATE_OP(s) INTEGER0(CDDR(s))[0]
+#define DEFERRED_ARITH_STATE_DEPTH(s) INTEGER0(CDDR(s))[1]
+
+/* Only vectors of at least this length are deferred, and trees are
+   at most DEFERRED_ARITH_MAX_DEPTH deep to bound the stack used by
+   Get_region. */
+#define DEFERRED_ARITH_MIN_N 65536
+#define DEFERRED_ARITH_MAX_DEPTH 16
+#define DEFERRED_ARITH_BLOCK 512
+
+static R_INLINE double deferred_arith_op(int op, double x, double y)
+{
+    switch (op) {
+    case PLUSOP: return x + y;
+    case MINUSOP: return x - y;
+    case TIMESOP: return x * y;
+    case DIVOP: return x / y;
+    case POWOP: return R_POW(x, y);
+    default: error("invalid deferred arithmetic operator");
+    }
+}
+
+static R_INLINE R_xlen_t deferred_arith_Length(SEXP x)
+{
+    SEXP state = DEFERRED_ARITH_STATE(x);
+    if (state == R_NilValue)
+	return XLENGTH(DEFERRED_ARITH_EXPANDED(x));
+    else {
+	R_xlen_t nx = XLENGTH(DEFERRED_ARITH_STATE_X(state));
+	R_xlen_t ny = XLENGTH(DEFERRED_ARITH_STATE_Y(state));
+	return nx > ny ? nx : ny;
+    }
+}
+
+static Rboolean deferred_arith_Inspect(SEXP x, int pre, int deep, int pvec,
+				       void (*inspect_subtree)(SEXP, int,
+							       int, int))
+{
+    SEXP state = DEFERRED_ARITH_STATE(x);
+    if (state != R_NilValue) {
+	int op = DEFERRED_ARITH_STATE_OP(state);
+	Rprintf("  <deferred arithmetic '%c' depth=%d>\n",
+		op >= PLUSOP && op <= POWOP ? "?+-*/^"[op] : '?',
+		DEFERRED_ARITH_STATE_DEPTH(state));
+	inspect_subtree(DEFERRED_ARITH_STATE_X(state), pre, deep, pvec);
+	inspect_subtree(DEFERRED_ARITH_STATE_Y(state), pre, deep, pvec);
+    }
+    else {
+	Rprintf("  <expanded arithmetic>\n");
+	inspect_subtree(DEFERRED_ARITH_EXPANDED(x), pre, deep, pvec);
+    }
+    return TRUE;
+}
+
+/* Pointer to the values i, ..., i + n - 1 of an operand, either into
+   its data or into buf. */
+static R_INLINE const double *
+deferred_arith_operand(SEXP x, R_xlen_t i, R_xlen_t n, double *buf)
+{
+    if (XLENGTH(x) == 1) {
+	double v = REAL_ELT(x, 0);
+	for (R_xlen_t k = 0; k < n; k++)
+	    buf[k] = v;
+	return buf;
+    }
+    const double *px = REAL_OR_NULL(x);
+    if (px != NULL)
+	return px + i;
+    REAL_GET_REGION(x, i, n, buf);
+    return buf;
+}
+
+static R_xlen_t
+deferred_arith_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, double *buf)
+{
+    R_xlen_t size = XLENGTH(sx);
+    R_xlen_t ncopy = size - i > n ? n : size - i;
+    SEXP state = DEFERRED_ARITH_STATE(sx);
+    if (state == R_NilValue) {
+	const double *y = REAL0(DEFERRED_ARITH_EXPANDED(sx));
+	for (R_xlen_t k = 0; k < ncopy; k++)
+	    buf[k] = y[i + k];
+	return ncopy;
+    }
+
+    SEXP sa = DEFERRED_ARITH_STATE_X(state);
+    SEXP sb = DEFERRED_ARITH_STATE_Y(state);
+    int op = DEFERRED_ARITH_STATE_OP(state);
+    double abuf[DEFERRED_ARITH_BLOCK], bbuf[DEFERRED_ARITH_BLOCK];
+    for (R_xlen_t k = 0; k < ncopy; k += DEFERRED_ARITH_BLOCK) {
+	R_xlen_t nk = ncopy - k < DEFERRED_ARITH_BLOCK ?
+	    ncopy - k : DEFERRED_ARITH_BLOCK;
+	const double *a = deferred_arith_operand(sa, i + k, nk, abuf);
+	const double *b = deferred_arith_operand(sb, i + k, nk, bbuf);
+	double *y = buf + k;
+	switch (op) {
+	case PLUSOP: for (R_xlen_t j = 0; j < nk; j++) y[j] = a[j] + b[j]; break;
+	case MINUSOP: for (R_xlen_t j = 0; j < nk; j++) y[j] = a[j] - b[j]; break;
+	case TIMESOP: for (R_xlen_t j = 0; j < nk; j++) y[j] = a[j] * b[j]; break;
+	case DIVOP: for (R_xlen_t j = 0; j < nk; j++) y[j] = a[j] / b[j]; break;
+	default:
+	    for (R_xlen_t j = 0; j < nk; j++)
+		y[j] = deferred_arith_op(op, a[j], b[j]);
+	}
+    }
+    return ncopy;
+}
+
+static R_INLINE void expand_deferred_arith(SEXP x)
+{
+    if (DEFERRED_ARITH_STATE(x) != R_NilValue) {
+	PROTECT(x);
+	R_xlen_t n = XLENGTH(x);
+	/* operands which are ALTREP may allocate in their Get_region */
+	SEXP val = PROTECT(allocVector(REALSXP, n));
+	deferred_arith_Get_region(x, 0, n, REAL0(val));
+	SET_DEFERRED_ARITH_EXPANDED(x, val);
+	CLEAR_DEFERRED_ARITH_STATE(x); /* allow the operands to be reclaimed */
+	UNPROTECT(2);
+    }
+}
+
+static SEXP deferred_arith_Serialized_state(SEXP x)
+{
+    /* always serialize the values: the operands could be much larger
+       than the result */
+    return NULL;
+}
+
+static SEXP deferred_arith_Duplicate(SEXP x, Rboolean deep)
+{
+    R_xlen_t n = XLENGTH(x);
+    SEXP val = PROTECT(allocVector(REALSXP, n));
+    REAL_GET_REGION(x, 0, n, REAL0(val));
+    UNPROTECT(1);
+    return val;
+}
+
+static void *deferred_arith_Dataptr(SEXP x, Rboolean writeable)
+{
+    expand_deferred_arith(x);
+    return DATAPTR(DEFERRED_ARITH_EXPANDED(x));
+}
+
+static const void *deferred_arith_Dataptr_or_null(SEXP x)
+{
+    SEXP state = DEFERRED_ARITH_STATE(x);
+    return state != R_NilValue ? NULL : DATAPTR(DEFERRED_ARITH_EXPANDED(x));
+}
+
+static double deferred_arith_Elt(SEXP x, R_xlen_t i)
+{
+    SEXP state = DEFERRED_ARITH_STATE(x);
+    if (state == R_NilValue)
+	return REAL0(DEFERRED_ARITH_EXPANDED(x))[i];
+    else {
+	SEXP sa = DEFERRED_ARITH_STATE_X(state);
+	SEXP sb = DEFERRED_ARITH_STATE_Y(state);
+	double a = REAL_ELT(sa, XLENGTH(sa) == 1 ? 0 : i);
+	double b = REAL_ELT(sb, XLENGTH(sb) == 1 ? 0 : i);
+	return deferred_arith_op(DEFERRED_ARITH_STATE_OP(state), a, b);
+    }
+}
+
+
+/*
+ * Class Object and Method Table
+ */
+
+static R_altrep_class_t R_deferred_arith_class;
+
+static void InitDeferredArithClass(void)
+{
+    R_altrep_class_t cls = R_make_altreal_class("deferred_arith", "base",
+						NULL);
+    R_deferred_arith_class = cls;
+
+    /* override ALTREP methods */
+    R_set_altrep_Serialized_state_method(cls, deferred_arith_Serialized_state);
+    R_set_altrep_Duplicate_method(cls, deferred_arith_Duplicate);
+    R_set_altrep_Inspect_method(cls, deferred_arith_Inspect);
+    R_set_altrep_Length_method(cls, deferred_arith_Length);
+
+    /* override ALTVEC methods */
+    R_set_altvec_Dataptr_method(cls, deferred_arith_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(cls, deferred_arith_Dataptr_or_null);
+
+    /* override ALTREAL methods */
+    R_set_altreal_Elt_method(cls, deferred_arith_Elt);
+    R_set_altreal_Get_region_method(cls, deferred_arith_Get_region);
+}
+
+
+/*
+ * Constructor
+ */
+
+static R_INLINE int deferred_arith_depth(SEXP x)
+{
+    if (ALTREP(x) && R_altrep_inherits(x, R_deferred_arith_class)) {
+	SEXP state = DEFERRED_ARITH_STATE(x);
+	if (state != R_NilValue)
+	    return DEFERRED_ARITH_STATE_DEPTH(state);
+    }
+    return 0;
+}
+
+/* Returns NULL if x op y is not to be deferred, so the caller computes
+   it as usual. */
+attribute_hidden SEXP R_deferred_arith(int code, SEXP x, SEXP y)
+{
+    if (TYPEOF(x) != REALSXP || TYPEOF(y) != REALSXP ||
+	ATTRIB(x) != R_NilValue || ATTRIB(y) != R_NilValue)
+	return NULL;
+
+    switch (code) {
+    case PLUSOP:
+    case MINUSOP:
+    case TIMESOP:
+    case DIVOP:
+    case POWOP: break;
+    default: return NULL;
+    }
+
+    R_xlen_t nx = XLENGTH(x), ny = XLENGTH(y);
+    R_xlen_t n = nx > ny ? nx : ny;
+    if (n < DEFERRED_ARITH_MIN_N || (nx != ny && nx != 1 && ny != 1))
+	return NULL;
+
+    int dx = deferred_arith_depth(x), dy = deferred_arith_depth(y);
+    int depth = 1 + (dx > dy ? dx : dy);
+    if (depth > DEFERRED_ARITH_MAX_DEPTH)
+	return NULL;
+
+    SEXP info = allocVector(INTSXP, 2);
+    INTEGER0(info)[0] = code;
+    INTEGER0(info)[1] = depth;
+    PROTECT(info);
+#ifndef SWITCH_TO_REFCNT
+    /* make sure the operands can't change once captured */
+    MARK_NOT_MUTABLE(x);
+    MARK_NOT_MUTABLE(y);
+#endif
+    SEXP ans = PROTECT(MAKE_DEFERRED_ARITH_STATE(x, y, info));
+    ans = R_new_altrep(R_deferred_arith_class, ans, R_NilValue);
+    UNPROTECT(2); /* ans, info */
+    return ans;
+}
+
+
+/**
+ ** Bit-Packed Logical Vectors
+ **/
+
+/* With options(bitset.logical = TRUE) comparisons and logical
+   operators producing long plain logical vectors return a bitset
+   object (see bitset.h) using two bits per element instead of 32.
+   which(), sum() and logical subscripts use the bits directly; any
+   other use of a data pointer expands the object into an ordinary
+   logical vector, which is then used from there on. */
+
+/*
+ * Methods
+ */
+
+#define BITSET_STATE(x) R_altrep_data1(x)
+#define	CLEAR_BITSET_STATE(x) R_set_altrep_data1(x, R_NilValue)
+#define BITSET_EXPANDED(x) R_altrep_data2(x)
+#define SET_BITSET_EXPANDED(x, v) R_set_altrep_data2(x, v)
+
+#define MAKE_BITSET_STATE(bits, nas, len) CONS(bits, CONS(nas, len))
+#define BITSET_STATE_BITS(s) R_BITSET_PTR(CAR(s))
+#define BITSET_STATE_NAS(s) \
+    (CADR(s) == R_NilValue ? NULL : R_BITSET_PTR(CADR(s)))
+#define BITSET_STATE_LENGTH(s) ((R_xlen_t) REAL0(CDDR(s))[0])
+
+static R_INLINE R_xlen_t bitset_Length(SEXP x)
+{
+    SEXP state = BITSET_STATE(x);
+    if (state == R_NilValue)
+	return XLENGTH(BITSET_EXPANDED(x));
+    else
+	return BITSET_STATE_LENGTH(state);
+}
+
+static Rboolean bitset_Inspect(SEXP x, int pre, int deep, int pvec,
+			       void (*inspect_subtree)(SEXP, int, int, int))
+{
+    SEXP state = BITSET_STATE(x);
+    if (state != R_NilValue)
+	Rprintf("  <bitset logical%s>\n",
+		CADR(state) == R_NilValue ? ", no NAs" : "");
+    else {
+	Rprintf("  <expanded bitset>\n");
+	inspect_subtree(BITSET_EXPANDED(x), pre, deep, pvec);
+    }
+    return TRUE;
+}
+
+static R_xlen_t bitset_Get_region(SEXP sx, R_xlen_t i, R_xlen_t n, int *buf)
+{
+    R_xlen_t size = XLENGTH(sx);
+    R_xlen_t ncopy = size - i > n ? n : size - i;
+    SEXP state = BITSET_STATE(sx);
+    if (state == R_NilValue) {
+	const int *y = LOGICAL0(BITSET_EXPANDED(sx));
+	for (R_xlen_t k = 0; k < ncopy; k++)
+	    buf[k] = y[i + k];
+    }
+    else {
+	const uint64_t *bits = BITSET_STATE_BITS(state);
+	const uint64_t *nas = BITSET_STATE_NAS(state);
+	for (R_xlen_t k = 0; k < ncopy; k++)
+	    buf[k] = R_BITSET_GET(bits, i + k);
+	if (nas != NULL)
+	    for (R_xlen_t k = 0; k < ncopy; k++)
+		if (R_BITSET_GET(nas, i + k))
+		    buf[k] = NA_LOGICAL;
+    }
+    return ncopy;
+}
+
+static R_INLINE void expand_bitset(SEXP x)
+{
+    if (BITSET_STATE(x) != R_NilValue) {
+	PROTECT(x);
+	R_xlen_t n = XLENGTH(x);
+	SEXP val = allocVector(LGLSXP, n);
+	bitset_Get_region(x, 0, n, LOGICAL0(val));
+	SET_BITSET_EXPANDED(x, val);
+	CLEAR_BITSET_STATE(x);
+	UNPROTECT(1);
+    }
+}
+
+static SEXP bitset_Serialized_state(SEXP x)
+{
+    /* serialize as an ordinary logical vector */
+    return NULL;
+}
+
+static SEXP bitset_Duplicate(SEXP x, Rboolean deep)
+{
+    SEXP state = BITSET_STATE(x);
+    if (state == R_NilValue)
+	return NULL;
+    /* the words are never modified, so they can be shared */
+    return R_bitset_logical(BITSET_STATE_LENGTH(state), CAR(state),
+			    CADR(state));
+}
+
+static void *bitset_Dataptr(SEXP x, Rboolean writeable)
+{
+    expand_bitset(x);
+    return DATAPTR(BITSET_EXPANDED(x));
+}
+
+static const void *bitset_Dataptr_or_null(SEXP x)
+{
+    SEXP state = BITSET_STATE(x);
+    return state != R_NilValue ? NULL : DATAPTR(BITSET_EXPANDED(x));
+}
+
+static int bitset_Elt(SEXP x, R_xlen_t i)
+{
+    SEXP state = BITSET_STATE(x);
+    if (state == R_NilValue)
+	return LOGICAL0(BITSET_EXPANDED(x))[i];
+    const uint64_t *nas = BITSET_STATE_NAS(state);
+    if (nas != NULL && R_BITSET_GET(nas, i))
+	return NA_LOGICAL;
+    return R_BITSET_GET(BITSET_STATE_BITS(state), i);
+}
+
+static int bitset_No_NA(SEXP x)
+{
+    SEXP state = BITSET_STATE(x);
+    return state != R_NilValue && CADR(state) == R_NilValue;
+}
+
+static SEXP bitset_Sum(SEXP x, Rboolean narm)
+{
+    SEXP state = BITSET_STATE(x);
+    if (state == R_NilValue)
+	return NULL;
+    if (CADR(state) != R_NilValue && ! narm)
+	return ScalarInteger(NA_INTEGER);
+    R_xlen_t cnt = R_bitset_count(BITSET_STATE_BITS(state),
+				  BITSET_STATE_LENGTH(state));
+    return cnt > INT_MAX ? NULL : ScalarInteger((int) cnt);
+}
+
+
+/*
+ * Class Object and Method Table
+ */
+
+static R_altrep_class_t R_bitset_logical_class;
+
+static void InitBitsetLogicalClass(void)
+{
+    R_altrep_class_t cls = R_make_altlogical_class("bitset_logical", "base",
+						   NULL);
+    R_bitset_logical_class = cls;
+
+    /* override ALTREP methods */
+    R_set_altrep_Serialized_state_method(cls, bitset_Serialized_state);
+    R_set_altrep_Duplicate_method(cls, bitset_Duplicate);
+    R_set_altrep_Inspect_method(cls, bitset_Inspect);
+    R_set_altrep_Length_method(cls, bitset_Length);
+
+    /* override ALTVEC methods */
+    R_set_altvec_Dataptr_method(cls, bitset_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(cls, bitset_Dataptr_or_null);
+
+    /* override ALTLOGICAL methods */
+    R_set_altlogical_Elt_method(cls, bitset_Elt);
+    R_set_altlogical_Get_region_method(cls, bitset_Get_region);
+    R_set_altlogical_No_NA_method(cls, bitset_No_NA);
+    R_set_altlogical_Sum_method(cls, bitset_Sum);
+}
+
+
+/*
+ * Constructor and Accessor
+ */
+
+/* 'bits' and 'nas' are as described in bitset.h; 'nas' can be
+   R_NilValue. */
+attribute_hidden SEXP R_bitset_logical(R_xlen_t n, SEXP bits, SEXP nas)
+{
+    SEXP len = PROTECT(ScalarReal((double) n));
+    SEXP state = PROTECT(MAKE_BITSET_STATE(bits, nas, len));
+    SEXP ans = R_new_altrep(R_bitset_logical_class, state, R_NilValue);
+    UNPROTECT(2); /* state, len */
+    return ans;
+}
+
+/* Returns TRUE and sets the word pointers if x is a bitset logical
+   vector that has not been expanded. */
+attribute_hidden Rboolean R_bitset_logical_words(SEXP x, const uint64_t **bits,
+						 const uint64_t **nas)
+{
+    if (ALTREP(x) && R_altrep_inherits(x, R_bitset_logical_class)) {
+	SEXP state = BITSET_STATE(x);
+	if (state != R_NilValue) {
+	    *bits = BITSET_STATE_BITS(state);
+	    *nas = BITSET_STATE_NAS(state);
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+
 /**
  ** Memory Mapped Vectors
  **/
@@ -1410,7 +3068,7 @@ attribute_hidden SEXP do_munmap_file(SEXP call, SEXP op, SEXP args, SEXP env)
  * Wrapper Classes and Objects
  */
 
-#define NMETA 2
+#define NMETA 3
 
 static R_altrep_class_t wrap_integer_class;
 static R_altrep_class_t wrap_logical_class;
@@ -1430,6 +3088,9 @@ static R_altrep_class_t wrap_list_class;
 
 #define WRAPPER_SORTED(x) INTEGER(WRAPPER_METADATA(x))[0]
 #define WRAPPER_NO_NA(x) INTEGER(WRAPPER_METADATA(x))[1]
+/* meta data from older serialized wrappers has no 'no_dups' field */
+#define WRAPPER_NO_DUPS(x) (XLENGTH(WRAPPER_METADATA(x)) > 2 &&	\
+			    INTEGER(WRAPPER_METADATA(x))[2])
 
 static R_INLINE SEXP WRAPPER_WRAPPED_RW(SEXP x)
 {
@@ -1446,7 +3107,7 @@ static R_INLINE SEXP WRAPPER_WRAPPED_RW(SEXP x)
        valid after a write. */
     SEXP meta = WRAPPER_METADATA(x);
     INTEGER(meta)[0] = UNKNOWN_SORTEDNESS;
-    for (int i = 1; i < NMETA; i++)
+    for (int i = 1; i < LENGTH(meta); i++)
 	INTEGER(meta)[i] = 0;
 
     return WRAPPER_WRAPPED(x);
@@ -1509,7 +3170,8 @@ static Rboolean wrapper_Inspect(SEXP x, int pre, int deep, int pvec,
 {
     Rboolean srt = WRAPPER_SORTED(x);
     Rboolean no_na = WRAPPER_NO_NA(x);
-    Rprintf(" wrapper [srt=%d,no_na=%d]\n", srt, no_na);
+    Rboolean no_dups = WRAPPER_NO_DUPS(x);
+    Rprintf(" wrapper [srt=%d,no_na=%d,no_dups=%d]\n", srt, no_na, no_dups);
     inspect_subtree(WRAPPER_WRAPPED(x), pre, deep, pvec);
     return TRUE;
 }
@@ -1960,7 +3622,7 @@ static R_INLINE int is_wrapper(SEXP x)
     else return FALSE;
 }
 
-static SEXP wrap_meta(SEXP x, int srt, int no_na)
+static SEXP wrap_meta_dups(SEXP x, int srt, int no_na, int no_dups)
 {
     switch(TYPEOF(x)) {
     case INTSXP:
@@ -1974,7 +3636,8 @@ static SEXP wrap_meta(SEXP x, int srt, int no_na)
     }
 
     /* avoid wrappers of wrappers, at least in some cases */
-    if (is_wrapper(x) && srt == UNKNOWN_SORTEDNESS && no_na == FALSE)
+    if (is_wrapper(x) && srt == UNKNOWN_SORTEDNESS && no_na == FALSE &&
+	no_dups == FALSE)
 	return shallow_duplicate(x);
 
 #ifndef WRAPATTRIB
@@ -1997,17 +3660,44 @@ static SEXP wrap_meta(SEXP x, int srt, int no_na)
     SEXP meta = allocVector(INTSXP, NMETA);
     INTEGER(meta)[0] = srt;
     INTEGER(meta)[1] = no_na;
+    INTEGER(meta)[2] = no_dups;
 
     return make_wrapper(x, meta);
 }
 
+static SEXP wrap_meta(SEXP x, int srt, int no_na)
+{
+    return wrap_meta_dups(x, srt, no_na, FALSE);
+}
+
+/* Results known to have no duplicated elements, such as those of
+   unique(), are wrapped with that meta data, along with any known
+   sortedness and absence of NAs.  Short ones are not wrapped as they
+   would gain little.  R_known_unique() tells whether x has been
+   wrapped so and not modified since. */
+#define UNIQUE_WRAP_MIN_N 1000
+
+attribute_hidden SEXP R_wrap_unique(SEXP x, int srt, int no_na)
+{
+    if (XLENGTH(x) < UNIQUE_WRAP_MIN_N)
+	return x;
+    return wrap_meta_dups(x, srt, no_na, TRUE);
+}
+
+attribute_hidden Rboolean R_known_unique(SEXP x)
+{
+    return is_wrapper(x) && WRAPPER_NO_DUPS(x);
+}
+
 attribute_hidden SEXP do_wrap_meta(SEXP call, SEXP op, SEXP args, SEXP env)
 {
     checkArity(op, args);
     SEXP x = CAR(args);
     int srt = asInteger(CADR(args));
     int no_na = asInteger(CADDR(args));
-    return wrap_meta(x, srt, no_na);
+    /* the values of x are a subset of those of 'from' */
+    int no_dups = R_known_unique(CADDDR(args));
+    return wrap_meta_dups(x, srt, no_na, no_dups);
 }
 
 SEXP /*attribute_hidden*/ R_tryWrap(SEXP x)
@@ -2037,7 +3727,8 @@ attribute_hidden SEXP do_tryWrap(SEXP call, SEXP op, SEXP args, SEXP env)
 attribute_hidden SEXP R_tryUnwrap(SEXP x)
 {
     if (! MAYBE_SHARED(x) && is_wrapper(x) &&
-	WRAPPER_SORTED(x) == UNKNOWN_SORTEDNESS && ! WRAPPER_NO_NA(x)) {
+	WRAPPER_SORTED(x) == UNKNOWN_SORTEDNESS && ! WRAPPER_NO_NA(x) &&
+	! WRAPPER_NO_DUPS(x)) {
 	SEXP data = WRAPPER_WRAPPED(x);
 	if (! MAYBE_SHARED(data)) {
 	    SET_ATTRIB(data, ATTRIB(x));
@@ -2071,7 +3762,12 @@ attribute_hidden void R_init_altrep(void)
 {
     InitCompactIntegerClass();
     InitCompactRealClass();
+    InitCompactCumsumClasses();
+    InitRepvecClasses();
+    InitViewClasses();
     InitDefferredStringClass();
+    InitDeferredArithClass();
+    InitBitsetLogicalClass();
     InitMmapIntegerClass(NULL);
     InitMmapRealClass(NULL);
     InitWrapIntegerClass(NULL);
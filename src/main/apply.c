@@ -24,12 +24,229 @@
 #include <Defn.h>
 #include <Internal.h>
 
+#include <float.h> // for DBL_MAX
+
 static SEXP checkArgIsSymbol(SEXP x) {
     if (TYPEOF(x) != SYMSXP)
 	error("argument must be a symbol");
     return x;
 }
 
+/* lapply() and vapply() of length(), sum() or anyNA() over a list, as
+   in lapply(l, length) or vapply(l, sum, 0), compute the values of
+   FUN(X[[i]]) directly rather than by evaluating the calls.  The
+   kernels below give the value the builtin would, without allocating
+   or signalling, so for long lists the elements are handled by
+   R_num_math_threads threads.  Each value depends on its element
+   only, so the results do not depend on the number of threads.  An
+   element a kernel does not handle (an object, an ALTREP vector, an
+   integer sum which does not fit, a NaN sum, ...) is left to the
+   call, as is everything when options(apply.threads) is false. */
+
+typedef enum {
+    APPLY_NONE, APPLY_LENGTH, APPLY_SUM, APPLY_ANYNA
+} apply_kernel;
+
+typedef struct {
+    SEXPTYPE type; /* of the value, or NILSXP to evaluate the call */
+    int ival;
+    double rval;
+} apply_value;
+
+#define APPLY_THREADS_MIN_N 1000
+
+static R_INLINE int apply_nthreads(R_xlen_t n)
+{
+#ifdef _OPENMP
+    if (n >= APPLY_THREADS_MIN_N && R_num_math_threads > 1)
+	return R_num_math_threads;
+#endif
+    return 1;
+}
+
+/* The kernel for FUN(X[[i]], ...) evaluated in rho, with FUN a symbol */
+static apply_kernel applyKernel(SEXP FUN, SEXP XX, SEXP rho)
+{
+    if (!R_ApplyThreads || TYPEOF(FUN) != SYMSXP ||
+	TYPEOF(XX) != VECSXP || OBJECT(XX) || ALTREP(XX))
+	return APPLY_NONE;
+    if (TYPEOF(findVarInFrame3(rho, R_DotsSymbol, TRUE)) == DOTSXP)
+	return APPLY_NONE;
+    SEXP f = findVarInFrame3(rho, FUN, TRUE);
+    if (TYPEOF(f) == PROMSXP)
+	f = PRVALUE(f);
+    if (TYPEOF(f) != BUILTINSXP)
+	return APPLY_NONE;
+    if (PRIMFUN(f) == do_length)
+	return APPLY_LENGTH;
+    if (PRIMFUN(f) == do_summary && PRIMVAL(f) == 0)
+	return APPLY_SUM;
+    if (PRIMFUN(f) == do_anyNA)
+	return APPLY_ANYNA;
+    return APPLY_NONE;
+}
+
+static void applyValue(apply_kernel k, SEXP x, apply_value *v)
+{
+    v->type = NILSXP;
+    if (OBJECT(x) || ALTREP(x))
+	return;
+    R_xlen_t n;
+    switch (TYPEOF(x)) {
+    case NILSXP:
+	n = 0;
+	break;
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP:
+    case STRSXP: case RAWSXP: case VECSXP: case EXPRSXP:
+	n = XLENGTH(x);
+	break;
+    default:
+	return;
+    }
+
+    switch (k) {
+    case APPLY_LENGTH:
+	if (n > INT_MAX) {
+	    v->type = REALSXP;
+	    v->rval = (double) n;
+	}
+	else {
+	    v->type = INTSXP;
+	    v->ival = (int) n;
+	}
+	break;
+    case APPLY_SUM:
+	switch (TYPEOF(x)) {
+	case NILSXP:
+	    v->type = INTSXP;
+	    v->ival = 0;
+	    break;
+#ifdef LONG_INT
+	case LGLSXP:
+	case INTSXP:
+	{
+	    const int *px = INTEGER0(x);
+	    LONG_INT s = 0;
+	    if (n > INT_MAX) /* might overflow s */
+		break;
+	    for (R_xlen_t i = 0; i < n; i++) {
+		if (px[i] == NA_INTEGER) {
+		    v->type = INTSXP;
+		    v->ival = NA_INTEGER;
+		    return;
+		}
+		s += px[i];
+	    }
+	    if (s <= INT_MAX && s >= -INT_MAX) { /* else left to sum() */
+		v->type = INTSXP;
+		v->ival = (int) s;
+	    }
+	    break;
+	}
+#endif
+	case REALSXP:
+	{
+	    const double *px = REAL0(x);
+	    double s = 0.0;
+	    if (n > 0) {
+		if (R_Summation == SUMMATION_LDOUBLE) {
+		    LDOUBLE ls = 0.0;
+		    for (R_xlen_t i = 0; i < n; i++)
+			ls += px[i];
+		    if (ls > DBL_MAX) s = R_PosInf;
+		    else if (ls < -DBL_MAX) s = R_NegInf;
+		    else s = (double) ls;
+		}
+		else {
+		    R_xlen_t cnt;
+		    s = R_rsum_array(px, n, FALSE, &cnt);
+		}
+		/* Whether NA or NaN results from both depends on the
+		   platform and the code generated, so leave it to sum() */
+		if (ISNAN(s))
+		    break;
+		s = 0.0 + s; /* as sum() adds to 0, so -0 gives 0 */
+	    }
+	    v->type = REALSXP;
+	    v->rval = s;
+	    break;
+	}
+	default:
+	    break;
+	}
+	break;
+    case APPLY_ANYNA:
+    {
+	int ans = FALSE;
+	switch (TYPEOF(x)) {
+	case NILSXP:
+	case RAWSXP:
+	    break;
+	case LGLSXP:
+	case INTSXP:
+	{
+	    const int *px = INTEGER0(x);
+	    for (R_xlen_t i = 0; i < n && !ans; i++)
+		ans = px[i] == NA_INTEGER;
+	    break;
+	}
+	case REALSXP:
+	{
+	    const double *px = REAL0(x);
+	    for (R_xlen_t i = 0; i < n && !ans; i++)
+		ans = ISNAN(px[i]);
+	    break;
+	}
+	case CPLXSXP:
+	{
+	    const Rcomplex *px = COMPLEX0(x);
+	    for (R_xlen_t i = 0; i < n && !ans; i++)
+		ans = ISNAN(px[i].r) || ISNAN(px[i].i);
+	    break;
+	}
+	case STRSXP:
+	{
+	    const SEXP *px = STRING_PTR_RO(x);
+	    for (R_xlen_t i = 0; i < n && !ans; i++)
+		ans = px[i] == NA_STRING;
+	    break;
+	}
+	default: /* lists need is.na() */
+	    return;
+	}
+	v->type = LGLSXP;
+	v->ival = ans;
+	break;
+    }
+    default:
+	break;
+    }
+}
+
+/* The values of kernel k for the elements of the list XX */
+static apply_value *applyValues(apply_kernel k, SEXP XX)
+{
+    R_xlen_t n = XLENGTH(XX);
+    apply_value *v = (apply_value *) R_alloc(n, sizeof(apply_value));
+#ifdef _OPENMP
+    int nthreads = apply_nthreads(n);
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 64) \
+    firstprivate(k, XX, v, n)
+#endif
+    for (R_xlen_t i = 0; i < n; i++)
+	applyValue(k, VECTOR_ELT(XX, i), v + i);
+    return v;
+}
+
+static R_INLINE SEXP applyValueSEXP(const apply_value *v)
+{
+    switch (v->type) {
+    case LGLSXP: return ScalarLogical(v->ival);
+    case INTSXP: return ScalarInteger(v->ival);
+    default:     return ScalarReal(v->rval);
+    }
+}
+
 /* .Internal(lapply(X, FUN)) */
 
 /* This is a special .Internal, so has unevaluated arguments.  It is
@@ -68,11 +285,17 @@ attribute_hidden SEXP do_lapply(SEXP call, SEXP op, SEXP args, SEXP rho)
     R_varloc_t loc = R_findVarLocInFrame(rho, isym);
     PROTECT_WITH_INDEX(loc.cell, &cidx);
 
+    const void *vmax = vmaxget();
+    apply_kernel k = applyKernel(FUN, XX, rho);
+    const apply_value *fv = k == APPLY_NONE ? NULL : applyValues(k, XX);
 
     for(R_xlen_t i = 0; i < n; i++) {
 	if (realIndx) REAL(ind)[0] = (double)(i + 1);
 	else INTEGER(ind)[0] = (int)(i + 1);
-	tmp = R_forceAndCall(R_fcall, 1, rho);
+	if (fv && fv[i].type != NILSXP)
+	    tmp = applyValueSEXP(fv + i);
+	else
+	    tmp = R_forceAndCall(R_fcall, 1, rho);
 	if (MAYBE_REFERENCED(tmp)) tmp = lazy_duplicate(tmp);
 	SET_VECTOR_ELT(ans, i, tmp);
 	if (ind != R_GetVarLocValue(loc) || MAYBE_SHARED(ind)) {
@@ -84,6 +307,7 @@ attribute_hidden SEXP do_lapply(SEXP call, SEXP op, SEXP args, SEXP rho)
 	    REPROTECT(loc.cell, cidx);
 	}
     }
+    vmaxset(vmax);
 
     UNPROTECT(6);
     return ans;
@@ -163,13 +387,20 @@ attribute_hidden SEXP do_vapply(SEXP call, SEXP op, SEXP args, SEXP rho)
 	PROTECT(R_fcall = LCONS(FUN,
 				LCONS(tmp, LCONS(R_DotsSymbol, R_NilValue))));
 
+	const void *vmax = vmaxget();
+	apply_kernel k = applyKernel(FUN, XX, rho);
+	const apply_value *fv = k == APPLY_NONE ? NULL : applyValues(k, XX);
+
 	int common_len_offset = 0;
 	for(i = 0; i < n; i++) {
 	    SEXP val; SEXPTYPE valType;
 	    PROTECT_INDEX indx;
 	    if (realIndx) REAL(ind)[0] = (double)(i + 1);
 	    else INTEGER(ind)[0] = (int)(i + 1);
-	    val = R_forceAndCall(R_fcall, 1, rho);
+	    if (fv && fv[i].type != NILSXP)
+		val = applyValueSEXP(fv + i);
+	    else
+		val = R_forceAndCall(R_fcall, 1, rho);
 	    if (MAYBE_REFERENCED(val))
 		val = lazy_duplicate(val); // Need to duplicate? Copying again anyway
 	    PROTECT_WITH_INDEX(val, &indx);
@@ -236,6 +467,7 @@ attribute_hidden SEXP do_vapply(SEXP call, SEXP op, SEXP args, SEXP rho)
 	    }
 	    UNPROTECT(1);
 	}
+	vmaxset(vmax);
 	UNPROTECT(3);
     }
 
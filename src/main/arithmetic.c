@@ -367,6 +367,71 @@ static R_INLINE double R_integer_divide(int x, int y)
 	return (double) x / (double) y;
 }
 
+/* Branch-free versions of R_integer_plus/minus/times for use in the
+   long loops of integer_binary.  The NA and overflow tests are
+   combined by selection rather than by early returns, and overflows
+   are accumulated into an int flag, so that compilers can vectorize
+   the loops (SSE2 is the x86_64 baseline, AVX2 etc. when enabled by
+   the compiler flags).  They give the same results as the functions
+   above: in particular a result of NA_INTEGER (= INT_MIN) counts as
+   an overflow.  The sums and differences are computed with unsigned
+   wrap-around, relying on a two's complement representation as the
+   code above does. */
+static R_INLINE int R_integer_plus_nb(int x, int y, int *povf)
+{
+    int z = (int) ((unsigned int) x + (unsigned int) y);
+    int na = (x == NA_INTEGER) | (y == NA_INTEGER);
+    int ovf = (!na) & ((((x ^ z) & (y ^ z)) < 0) | (z == NA_INTEGER));
+    *povf |= ovf;
+    return (na | ovf) ? NA_INTEGER : z;
+}
+
+static R_INLINE int R_integer_minus_nb(int x, int y, int *povf)
+{
+    int z = (int) ((unsigned int) x - (unsigned int) y);
+    int na = (x == NA_INTEGER) | (y == NA_INTEGER);
+    int ovf = (!na) & ((((x ^ y) & (x ^ z)) < 0) | (z == NA_INTEGER));
+    *povf |= ovf;
+    return (na | ovf) ? NA_INTEGER : z;
+}
+
+static R_INLINE int R_integer_times_nb(int x, int y, int *povf)
+{
+    int64_t z = (int64_t) x * (int64_t) y;
+    int na = (x == NA_INTEGER) | (y == NA_INTEGER);
+    int ovf = (!na) & ((z > R_INT_MAX) | (z < R_INT_MIN));
+    *povf |= ovf;
+    return (na | ovf) ? NA_INTEGER : (int) z;
+}
+
+/* The loop of integer_binary for the branch-free functions above,
+   with separate loops for the common equal-length and scalar cases
+   which do not need the recycling indices. */
+#define INTEGER_BINARY_LOOP(FUN) do {					\
+	int *pa = INTEGER(ans);						\
+	const int *px1 = INTEGER_RO(s1);				\
+	const int *px2 = INTEGER_RO(s2);				\
+	int ovf = 0;							\
+	if (n1 == n2)							\
+	    R_ITERATE_CHECK(NINTERRUPT, n, i,				\
+			    pa[i] = FUN(px1[i], px2[i], &ovf););	\
+	else if (n2 == 1) {						\
+	    int tmp = px2[0];						\
+	    R_ITERATE_CHECK(NINTERRUPT, n, i,				\
+			    pa[i] = FUN(px1[i], tmp, &ovf););		\
+	}								\
+	else if (n1 == 1) {						\
+	    int tmp = px1[0];						\
+	    R_ITERATE_CHECK(NINTERRUPT, n, i,				\
+			    pa[i] = FUN(tmp, px2[i], &ovf););		\
+	}								\
+	else								\
+	    MOD_ITERATE2_CHECK(NINTERRUPT, n, n1, n2, i, i1, i2,	\
+			       pa[i] = FUN(px1[i1], px2[i2], &ovf););	\
+	if (ovf)							\
+	    naflag = TRUE;						\
+    } while (0)
+
 static R_INLINE SEXP ScalarValue1(SEXP x)
 {
     if (NO_REFERENCES(x))
@@ -665,7 +730,11 @@ attribute_hidden SEXP R_binary(SEXP call, SEXP op, SEXP x, SEXP y)
 	/* Can get a LGLSXP. In base-Ex.R on 24 Oct '06, got 8 of these. */
 	if (TYPEOF(x) != INTSXP) COERCE_IF_NEEDED(x, REALSXP, xpi);
 	if (TYPEOF(y) != INTSXP) COERCE_IF_NEEDED(y, REALSXP, ypi);
-	val = real_binary(oper, x, y);
+	val = NULL;
+	if (R_DeferredArith && ! xattr && ! yattr)
+	    val = R_deferred_arith(oper, x, y);
+	if (val == NULL)
+	    val = real_binary(oper, x, y);
     }
     else val = integer_binary(oper, x, y, call);
 
@@ -822,57 +891,34 @@ static SEXP integer_binary(ARITHOP_TYPE code, SEXP s1, SEXP s2, SEXP lcall)
 
     switch (code) {
     case PLUSOP:
-	{
-	    int *pa = INTEGER(ans);
-	    const int *px1 = INTEGER_RO(s1);
-	    const int *px2 = INTEGER_RO(s2);
-	    MOD_ITERATE2_CHECK(NINTERRUPT, n, n1, n2, i, i1, i2, {
-		    x1 = px1[i1];
-		    x2 = px2[i2];
-		    pa[i] = R_integer_plus(x1, x2, &naflag);
-		});
-	    if (naflag)
-		warningcall(lcall, INTEGER_OVERFLOW_WARNING);
-	}
+	INTEGER_BINARY_LOOP(R_integer_plus_nb);
+	if (naflag)
+	    warningcall(lcall, INTEGER_OVERFLOW_WARNING);
 	break;
     case MINUSOP:
-	{
-	    int *pa = INTEGER(ans);
-	    const int *px1 = INTEGER_RO(s1);
-	    const int *px2 = INTEGER_RO(s2);
-	    MOD_ITERATE2_CHECK(NINTERRUPT, n, n1, n2, i, i1, i2, {
-		    x1 = px1[i1];
-		    x2 = px2[i2];
-		    pa[i] = R_integer_minus(x1, x2, &naflag);
-		});
-	    if (naflag)
-		warningcall(lcall, INTEGER_OVERFLOW_WARNING);
-	}
+	INTEGER_BINARY_LOOP(R_integer_minus_nb);
+	if (naflag)
+	    warningcall(lcall, INTEGER_OVERFLOW_WARNING);
 	break;
     case TIMESOP:
-	{
-	    int *pa = INTEGER(ans);
-	    const int *px1 = INTEGER_RO(s1);
-	    const int *px2 = INTEGER_RO(s2);
-	    MOD_ITERATE2_CHECK(NINTERRUPT, n, n1, n2, i, i1, i2, {
-		    x1 = px1[i1];
-		    x2 = px2[i2];
-		    pa[i] = R_integer_times(x1, x2, &naflag);
-		});
-	    if (naflag)
-		warningcall(lcall, INTEGER_OVERFLOW_WARNING);
-	}
+	INTEGER_BINARY_LOOP(R_integer_times_nb);
+	if (naflag)
+	    warningcall(lcall, INTEGER_OVERFLOW_WARNING);
 	break;
     case DIVOP:
 	{
 	    double *pa = REAL(ans);
 	    const int *px1 = INTEGER_RO(s1);
 	    const int *px2 = INTEGER_RO(s2);
-	    MOD_ITERATE2_CHECK(NINTERRUPT, n, n1, n2, i, i1, i2, {
-		    x1 = px1[i1];
-		    x2 = px2[i2];
-		    pa[i] = R_integer_divide(x1, x2);
-		});
+	    if (n1 == n2)
+		R_ITERATE_CHECK(NINTERRUPT, n, i,
+				pa[i] = R_integer_divide(px1[i], px2[i]););
+	    else
+		MOD_ITERATE2_CHECK(NINTERRUPT, n, n1, n2, i, i1, i2, {
+			x1 = px1[i1];
+			x2 = px2[i2];
+			pa[i] = R_integer_divide(x1, x2);
+		    });
 	}
 	break;
     case POWOP:
@@ -1194,12 +1240,71 @@ static SEXP real_binary(ARITHOP_TYPE code, SEXP s1, SEXP s2)
 }
 
 
+/* Element-wise math functions on long vectors can be run on
+   R_num_math_threads threads, as do_colsum does.  Each thread handles
+   fixed chunks of the vector, so the results do not depend on the
+   number of threads.  Only functions which never call back into R may
+   be used from the threads: the nmath functions signal problems via
+   warning(), so those which can warn are used only sequentially or,
+   for gammafn and lgammafn, when all arguments are in a range where
+   they do not warn (see math1_threadsafe). */
+
+#define MATH_THREADS_MIN_N 100000
+#define MATH_THREADS_CHUNK 8192
+
+static R_INLINE int math_nthreads(R_xlen_t n)
+{
+#ifdef _OPENMP
+    if (n >= MATH_THREADS_MIN_N && R_num_math_threads > 1)
+	return R_num_math_threads;
+#endif
+    return 1;
+}
+
 /* Mathematical Functions of One Argument */
 
+static int math1_range(double (*f)(double), const double *a, double *y,
+		       R_xlen_t from, R_xlen_t to)
+{
+    int naflag = 0;
+    for (R_xlen_t i = from; i < to; i++) {
+	double x = a[i]; /* in case y == a */
+	/* This code assumes that ISNAN(x) implies ISNAN(f(x)), so we
+	   only need to check ISNAN(x) if ISNAN(f(x)) is true. */
+	y[i] = f(x);
+	if (ISNAN(y[i])) {
+	    if (ISNAN(x))
+		y[i] = x; /* make sure the incoming NaN is preserved */
+	    else
+		naflag = 1;
+	}
+    }
+    return naflag;
+}
+
+/* gammafn warns for arguments close to zero, above 171.61 and close
+   to negative integers, lgammafn only for the latter. The other
+   functions used with math1 do not call back into R. */
+static Rboolean math1_threadsafe(double (*f)(double), const double *a,
+				 R_xlen_t n)
+{
+    if (f == gammafn) {
+	for (R_xlen_t i = 0; i < n; i++)
+	    if (a[i] < 1e-306 || a[i] > 171)
+		return FALSE;
+    }
+    else if (f == lgammafn) {
+	for (R_xlen_t i = 0; i < n; i++)
+	    if (a[i] <= 0)
+		return FALSE;
+    }
+    return TRUE;
+}
+
 static SEXP math1(SEXP sa, double(*f)(double), SEXP lcall)
 {
     SEXP sy;
-    R_xlen_t i, n;
+    R_xlen_t n;
     int naflag;
 
     if (!isNumeric(sa))
@@ -1211,19 +1316,19 @@ static SEXP math1(SEXP sa, double(*f)(double), SEXP lcall)
     PROTECT(sy = NO_REFERENCES(sa) ? sa : allocVector(REALSXP, n));
     const double *a = REAL_RO(sa);
     double *y = REAL(sy);
-    naflag = 0;
-    for (i = 0; i < n; i++) {
-	double x = a[i]; /* in case y == a */
-	/* This code assumes that ISNAN(x) implies ISNAN(f(x)), so we
-	   only need to check ISNAN(x) if ISNAN(f(x)) is true. */
-	y[i] = f(x);
-	if (ISNAN(y[i])) {
-	    if (ISNAN(x))
-		y[i] = x; /* make sure the incoming NaN is preserved */
-	    else
-		naflag = 1;
-	}
+    int nthreads = math_nthreads(n);
+    if (nthreads > 1 && math1_threadsafe(f, a, n)) {
+	naflag = 0;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(f, a, y, n) reduction(|:naflag)
+#endif
+	for (R_xlen_t k = 0; k < n; k += MATH_THREADS_CHUNK)
+	    naflag |= math1_range(f, a, y, k, n - k < MATH_THREADS_CHUNK ?
+				  n : k + MATH_THREADS_CHUNK);
     }
+    else
+	naflag = math1_range(f, a, y, 0, n);
     /* These are primitives, so need to use the call */
     if(naflag) warningcall(lcall, R_MSG_NA);
 
@@ -1370,12 +1475,38 @@ attribute_hidden SEXP do_abs(SEXP call, SEXP op, SEXP args, SEXP env)
 	if      (ISNA (a) || ISNA (b)) y = NA_REAL;	\
 	else if (ISNAN(a) || ISNAN(b)) y = R_NaN;
 
+static int math2_range(double (*f)(double, double),
+		       const double *a, const double *b, double *y,
+		       R_xlen_t na, R_xlen_t nb, R_xlen_t from, R_xlen_t to)
+{
+    R_xlen_t i = from, ia = from % na, ib = from % nb;
+    double ai, bi;
+    int naflag = 0;
+
+    MOD_ITERATE2_CORE(to, na, nb, i, ia, ib, {
+	ai = a[ia];
+	bi = b[ib];
+	if_NA_Math2_set(y[i], ai, bi)
+	else {
+	    y[i] = f(ai, bi);
+	    if (ISNAN(y[i])) naflag = 1;
+	}
+    });
+    return naflag;
+}
+
+/* Of the functions used with math2 only these never warn */
+static R_INLINE Rboolean math2_threadsafe(double (*f)(double, double))
+{
+    return f == atan2 || f == fround || f == fprec;
+}
+
 static SEXP math2(SEXP sa, SEXP sb, double (*f)(double, double),
 		  SEXP lcall)
 {
     SEXP sy;
-    R_xlen_t i, ia, ib, n, na, nb;
-    double ai, bi, *y;
+    R_xlen_t n, na, nb;
+    double *y;
     const double *a, *b;
 
     /* for 0-length a we want the attributes of a,
@@ -1403,16 +1534,19 @@ static SEXP math2(SEXP sa, SEXP sb, double (*f)(double, double),
 
     SETUP_Math2;
 
-    MOD_ITERATE2(n, na, nb, i, ia, ib, {
-//	if ((i+1) % NINTERRUPT == 0) R_CheckUserInterrupt();
-	ai = a[ia];
-	bi = b[ib];
-	if_NA_Math2_set(y[i], ai, bi)
-	else {
-	    y[i] = f(ai, bi);
-	    if (ISNAN(y[i])) naflag = 1;
-	}
-    });
+    int nthreads = math_nthreads(n);
+    if (nthreads > 1 && math2_threadsafe(f)) {
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(f, a, b, y, n, na, nb) reduction(|:naflag)
+#endif
+	for (R_xlen_t k = 0; k < n; k += MATH_THREADS_CHUNK)
+	    naflag |= math2_range(f, a, b, y, na, nb, k,
+				  n - k < MATH_THREADS_CHUNK ?
+				  n : k + MATH_THREADS_CHUNK);
+    }
+    else
+	naflag = math2_range(f, a, b, y, na, nb, 0, n);
 
 #define FINISH_Math2					\
     if(naflag) warning(R_MSG_NA);			\
@@ -1922,6 +1922,7 @@ attribute_hidden SEXP do_colsum(SEXP call, SEXP op, SEXP args, SEXP rho)
 
     int OP = PRIMVAL(op);
     if (OP == 0 || OP == 1) { /* columns */
+	Rboolean ldouble = R_Summation == SUMMATION_LDOUBLE;
 	PROTECT(ans = allocVector(REALSXP, p));
 #ifdef _OPENMP
 	int nthreads;
@@ -1931,7 +1932,8 @@ attribute_hidden SEXP do_colsum(SEXP call, SEXP op, SEXP args, SEXP rho)
 	else
 	    nthreads = 1; /* for now */
 #pragma omp parallel for num_threads(nthreads) default(none) \
-    firstprivate(x, ans, n, p, type, NaRm, keepNA, R_NaReal, R_NaInt, OP)
+    firstprivate(x, ans, n, p, type, NaRm, keepNA, R_NaReal, R_NaInt, OP, \
+		 ldouble)
 #endif
 	for (R_xlen_t j = 0; j < p; j++) {
 	    R_xlen_t  cnt = n, i;
@@ -1940,7 +1942,9 @@ attribute_hidden SEXP do_colsum(SEXP call, SEXP op, SEXP args, SEXP rho)
 	    case REALSXP:
 	    {
 		double *rx = REAL(x) + (R_xlen_t)n*j;
-		if (keepNA)
+		if (!ldouble) /* options(summation) */
+		    sum = R_rsum_array(rx, n, NaRm, &cnt);
+		else if (keepNA)
 		    for (sum = 0., i = 0; i < n; i++) sum += *rx++;
 		else {
 		    for (cnt = 0, sum = 0., i = 0; i < n; i++, rx++)
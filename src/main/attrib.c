@@ -491,7 +491,7 @@ static SEXP commentgets(SEXP vec, SEXP comment)
 attribute_hidden SEXP do_commentgets(SEXP call, SEXP op, SEXP args, SEXP env)
 {
     checkArity(op, args);
-    if (MAYBE_SHARED(CAR(args))) SETCAR(args, duplicate(CAR(args)));
+    if (MAYBE_SHARED(CAR(args))) SETCAR(args, R_shallow_duplicate_attr(CAR(args)));
     if (length(CADR(args)) == 0) SETCADR(args, R_NilValue);
     setAttrib(CAR(args), R_CommentSymbol, CADR(args));
     SETTER_CLEAR_NAMED(CAR(args));
@@ -1019,6 +1019,29 @@ SEXP namesgets(SEXP vec, SEXP val)
 #define isS4Environment(x) (TYPEOF(x) == S4SXP &&	\
 			    isEnvironment(R_getS4DataSlot(x, ENVSXP)))
 
+/* In the getter call of a complex assignment, as names(*tmp*) in
+   names(x)[i] <- v, an attribute value is returned without marking it
+   not mutable, so that it can be modified in place if nothing else
+   references it.  This is not done for the attributes whose setters
+   check consistency with the object, as that check could fail after
+   the value had been modified, nor for values which could be grown in
+   place (see EnlargeVector in subassign.c). */
+static SEXP getterAttrib(SEXP call, SEXP vec, SEXP name)
+{
+    if (IS_GETTER_CALL(call) && isVector(vec) &&
+	name != R_DimSymbol && name != R_DimNamesSymbol &&
+	name != R_ClassSymbol && name != R_TspSymbol &&
+	name != R_CommentSymbol && name != R_RowNamesSymbol &&
+	(name != R_NamesSymbol || !isOneDimensionalArray(vec)))
+	for (SEXP s = ATTRIB(vec); s != R_NilValue; s = CDR(s))
+	    if (TAG(s) == name) {
+		if (GROWABLE_BIT_SET(CAR(s)))
+		    break;
+		return CAR(s);
+	    }
+    return getAttrib(vec, name);
+}
+
 attribute_hidden SEXP do_names(SEXP call, SEXP op, SEXP args, SEXP env)
 {
     SEXP ans;
@@ -1032,7 +1055,7 @@ attribute_hidden SEXP do_names(SEXP call, SEXP op, SEXP args, SEXP env)
     if (isEnvironment(ans) || isS4Environment(ans))
 	ans = R_lsInternal3(ans, TRUE, FALSE);
     else if (isVector(ans) || isList(ans) || isLanguage(ans) || IS_S4_OBJECT(ans) || TYPEOF(ans) == DOTSXP)
-	ans = getAttrib(ans, R_NamesSymbol);
+	ans = getterAttrib(call, ans, R_NamesSymbol);
     else ans = R_NilValue;
     UNPROTECT(1);
     return ans;
@@ -1324,7 +1347,7 @@ attribute_hidden SEXP do_levelsgets(SEXP call, SEXP op, SEXP args, SEXP env)
     args = ans;
     if (MAYBE_SHARED(CAR(args)) ||
 	((! IS_ASSIGNMENT_CALL(call)) && MAYBE_REFERENCED(CAR(args))))
-	SETCAR(args, duplicate(CAR(args)));
+	SETCAR(args, R_shallow_duplicate_attr(CAR(args)));
     setAttrib(CAR(args), R_LevelsSymbol, CADR(args));
     UNPROTECT(1);
     return CAR(args);
@@ -1550,7 +1573,7 @@ attribute_hidden SEXP do_attr(SEXP call, SEXP op, SEXP args, SEXP env)
 	warningcall(call, _("partial match of '%s' to '%s'"), str,
 		    CHAR(PRINTNAME(tag)));
 
-    ans =  getAttrib(s, tag);
+    ans = getterAttrib(call, s, tag);
     UNPROTECT(1);
     return ans;
 }
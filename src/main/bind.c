@@ -27,7 +27,6 @@
 
 #include <Defn.h>
 #include <Internal.h>
-#include <R_ext/PrtUtil.h> // for IndexWidth
 #include <R_ext/Itermacros.h>
 #define imax2(x, y) ((x < y) ? y : x)
 
@@ -259,6 +258,32 @@ StringAnswer(SEXP x, struct BindData *data, SEXP call)
     }
 }
 
+/* The atomic cases copy or convert the elements of x a region at a
+   time, so that ALTREP vectors need not be expanded. */
+
+#define COPY_ANSWER(GET_REGION, APTR) do {				\
+	GET_REGION(x, 0, XLENGTH(x),					\
+		   APTR(data->ans_ptr) + data->ans_length);		\
+	data->ans_length += XLENGTH(x);					\
+    } while (0)
+
+#define CONVERT_ANSWER(XTYPE, XPTR, ATYPE, APTR, EXPR) do {		\
+	ATYPE *pa = APTR(data->ans_ptr) + data->ans_length;		\
+	ITERATE_BY_REGION(x, px, idx, nb, XTYPE, XPTR, {		\
+		for (R_xlen_t k = 0; k < nb; k++) {			\
+		    XTYPE v = px[k];					\
+		    pa[idx + k] = EXPR;					\
+		}							\
+	    });								\
+	data->ans_length += XLENGTH(x);					\
+    } while (0)
+
+static R_INLINE Rcomplex toComplex(double r, double i)
+{
+    Rcomplex z = { .r = r, .i = i };
+    return z;
+}
+
 static void
 LogicalAnswer(SEXP x, struct BindData *data, SEXP call)
 {
@@ -278,18 +303,14 @@ LogicalAnswer(SEXP x, struct BindData *data, SEXP call)
 	    LogicalAnswer(VECTOR_ELT(x, i), data, call);
 	break;
     case LGLSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    LOGICAL(data->ans_ptr)[data->ans_length++] = LOGICAL(x)[i];
+	COPY_ANSWER(LOGICAL_GET_REGION, LOGICAL);
 	break;
     case INTSXP:
-	for (i = 0; i < XLENGTH(x); i++) {
-	    int v = INTEGER(x)[i];
-	    LOGICAL(data->ans_ptr)[data->ans_length++] = (v == NA_INTEGER) ? NA_LOGICAL : ( v != 0 );
-	}
+	CONVERT_ANSWER(int, INTEGER, int, LOGICAL,
+		       (v == NA_INTEGER) ? NA_LOGICAL : (v != 0));
 	break;
     case RAWSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    LOGICAL(data->ans_ptr)[data->ans_length++] = (int)RAW(x)[i] != 0;
+	CONVERT_ANSWER(Rbyte, RAW, int, LOGICAL, (int) v != 0);
 	break;
     default:
 	errorcall(call, _("type '%s' is unimplemented in '%s'"),
@@ -316,16 +337,13 @@ IntegerAnswer(SEXP x, struct BindData *data, SEXP call)
 	    IntegerAnswer(VECTOR_ELT(x, i), data, call);
 	break;
     case LGLSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    INTEGER(data->ans_ptr)[data->ans_length++] = LOGICAL(x)[i];
+	COPY_ANSWER(LOGICAL_GET_REGION, INTEGER);
 	break;
     case INTSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    INTEGER(data->ans_ptr)[data->ans_length++] = INTEGER(x)[i];
+	COPY_ANSWER(INTEGER_GET_REGION, INTEGER);
 	break;
     case RAWSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    INTEGER(data->ans_ptr)[data->ans_length++] = (int)RAW(x)[i];
+	CONVERT_ANSWER(Rbyte, RAW, int, INTEGER, (int) v);
 	break;
     default:
 	errorcall(call, _("type '%s' is unimplemented in '%s'"),
@@ -337,7 +355,6 @@ static void
 RealAnswer(SEXP x, struct BindData *data, SEXP call)
 {
     R_xlen_t i;
-    int xi;
     switch(TYPEOF(x)) {
     case NILSXP:
 	break;
@@ -353,28 +370,18 @@ RealAnswer(SEXP x, struct BindData *data, SEXP call)
 	    RealAnswer(VECTOR_ELT(x, i), data, call);
 	break;
     case REALSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    REAL(data->ans_ptr)[data->ans_length++] = REAL(x)[i];
+	COPY_ANSWER(REAL_GET_REGION, REAL);
 	break;
     case LGLSXP:
-	for (i = 0; i < XLENGTH(x); i++) {
-	    xi = LOGICAL(x)[i];
-	    if (xi == NA_LOGICAL)
-		REAL(data->ans_ptr)[data->ans_length++] = NA_REAL;
-	    else REAL(data->ans_ptr)[data->ans_length++] = xi;
-	}
+	CONVERT_ANSWER(int, LOGICAL, double, REAL,
+		       (v == NA_LOGICAL) ? NA_REAL : v);
 	break;
     case INTSXP:
-	for (i = 0; i < XLENGTH(x); i++) {
-	    xi = INTEGER(x)[i];
-	    if (xi == NA_INTEGER)
-		REAL(data->ans_ptr)[data->ans_length++] = NA_REAL;
-	    else REAL(data->ans_ptr)[data->ans_length++] = xi;
-	}
+	CONVERT_ANSWER(int, INTEGER, double, REAL,
+		       (v == NA_INTEGER) ? NA_REAL : v);
 	break;
     case RAWSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    REAL(data->ans_ptr)[data->ans_length++] = (int)RAW(x)[i];
+	CONVERT_ANSWER(Rbyte, RAW, double, REAL, (int) v);
 	break;
     default:
 	errorcall(call, _("type '%s' is unimplemented in '%s'"),
@@ -386,7 +393,6 @@ static void
 ComplexAnswer(SEXP x, struct BindData *data, SEXP call)
 {
     R_xlen_t i;
-    int xi;
     switch(TYPEOF(x)) {
     case NILSXP:
 	break;
@@ -402,51 +408,24 @@ ComplexAnswer(SEXP x, struct BindData *data, SEXP call)
 	    ComplexAnswer(VECTOR_ELT(x, i), data, call);
 	break;
     case REALSXP:
-	for (i = 0; i < XLENGTH(x); i++) {
-	    COMPLEX(data->ans_ptr)[data->ans_length].r = REAL(x)[i];
-	    COMPLEX(data->ans_ptr)[data->ans_length].i = 0.0;
-	    data->ans_length++;
-	}
+	CONVERT_ANSWER(double, REAL, Rcomplex, COMPLEX, toComplex(v, 0.0));
 	break;
     case CPLXSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    COMPLEX(data->ans_ptr)[data->ans_length++] = COMPLEX(x)[i];
+	COPY_ANSWER(COMPLEX_GET_REGION, COMPLEX);
 	break;
     case LGLSXP:
-	for (i = 0; i < XLENGTH(x); i++) {
-	    xi = LOGICAL(x)[i];
-	    if (xi == NA_LOGICAL) {
-		COMPLEX(data->ans_ptr)[data->ans_length].r = NA_REAL;
-		COMPLEX(data->ans_ptr)[data->ans_length].i = NA_REAL;
-	    }
-	    else {
-		COMPLEX(data->ans_ptr)[data->ans_length].r = xi;
-		COMPLEX(data->ans_ptr)[data->ans_length].i = 0.0;
-	    }
-	    data->ans_length++;
-	}
+	CONVERT_ANSWER(int, LOGICAL, Rcomplex, COMPLEX,
+		       (v == NA_LOGICAL) ? toComplex(NA_REAL, NA_REAL)
+		       : toComplex(v, 0.0));
 	break;
     case INTSXP:
-	for (i = 0; i < XLENGTH(x); i++) {
-	    xi = INTEGER(x)[i];
-	    if (xi == NA_INTEGER) {
-		COMPLEX(data->ans_ptr)[data->ans_length].r = NA_REAL;
-		COMPLEX(data->ans_ptr)[data->ans_length].i = NA_REAL;
-	    }
-	    else {
-		COMPLEX(data->ans_ptr)[data->ans_length].r = xi;
-		COMPLEX(data->ans_ptr)[data->ans_length].i = 0.0;
-	    }
-	    data->ans_length++;
-	}
+	CONVERT_ANSWER(int, INTEGER, Rcomplex, COMPLEX,
+		       (v == NA_INTEGER) ? toComplex(NA_REAL, NA_REAL)
+		       : toComplex(v, 0.0));
 	break;
 
     case RAWSXP:
-	for (i = 0; i < XLENGTH(x); i++) {
-	    COMPLEX(data->ans_ptr)[data->ans_length].r = (int)RAW(x)[i];
-	    COMPLEX(data->ans_ptr)[data->ans_length].i = 0.0;
-	    data->ans_length++;
-	}
+	CONVERT_ANSWER(Rbyte, RAW, Rcomplex, COMPLEX, toComplex((int) v, 0.0));
 	break;
 
     default:
@@ -474,8 +453,7 @@ RawAnswer(SEXP x, struct BindData *data, SEXP call)
 	    RawAnswer(VECTOR_ELT(x, i), data, call);
 	break;
     case RAWSXP:
-	for (i = 0; i < XLENGTH(x); i++)
-	    RAW(data->ans_ptr)[data->ans_length++] = RAW(x)[i];
+	COPY_ANSWER(RAW_GET_REGION, RAW);
 	break;
     default:
 	errorcall(call, _("type '%s' is unimplemented in '%s'"),
@@ -483,21 +461,46 @@ RawAnswer(SEXP x, struct BindData *data, SEXP call)
     }
 }
 
+/* The UTF-8 name "sb.st", or "sb<seqno>" if st is NULL.  Names are
+   made for every element of the result, so this is done by copying
+   into cbuff rather than with snprintf. */
+static SEXP pasteName(const char *sb, const char *st, R_xlen_t seqno)
+{
+    size_t lb = strlen(sb), lt = st ? strlen(st) + 1 : 0;
+    char digits[24], *p;
+    int nd = 0;
+    if (st == NULL) {
+	do {
+	    digits[nd++] = (char) ('0' + seqno % 10);
+	    seqno /= 10;
+	} while (seqno > 0);
+	lt = nd;
+    }
+    p = R_AllocStringBuffer(lb + lt, &cbuff);
+    memcpy(p, sb, lb);
+    if (st) {
+	p[lb] = '.';
+	memcpy(p + lb + 1, st, lt - 1);
+    }
+    else
+	for (int k = 0; k < nd; k++)
+	    p[lb + k] = digits[nd - 1 - k];
+    if (lb + lt > INT_MAX)
+	error(_("result would exceed 2^31-1 bytes"));
+    return mkCharLenCE(p, (int) (lb + lt), CE_UTF8);
+}
+
 static SEXP NewBase(SEXP base, SEXP tag)
 {
     SEXP ans;
-    char *cbuf;
     base = EnsureString(base);
     tag = EnsureString(tag);
     if (*CHAR(base) && *CHAR(tag)) { /* test of length */
 	const void *vmax = vmaxget();
 	const char *sb = translateCharUTF8(base), *st = translateCharUTF8(tag);
-	size_t sz = strlen(st) + strlen(sb) + 1;
-	cbuf = R_AllocStringBuffer(sz, &cbuff);
-	snprintf(cbuf, sz + 1, "%s.%s", sb, st);
 	/* This isn't strictly correct as we do not know that all the
 	   components of the name were correctly translated. */
-	ans = mkCharCE(cbuf, CE_UTF8);
+	ans = pasteName(sb, st, 0);
 	vmaxset(vmax);
     }
     else if (*CHAR(tag)) {
@@ -525,30 +528,14 @@ static SEXP NewName(SEXP base, SEXP tag, R_xlen_t seqno, int count)
     if (*CHAR(base)) {
 	if (*CHAR(tag)) {
 	    const void *vmax = vmaxget();
-	    const char
-		*sb = translateCharUTF8(base),
-		*st = translateCharUTF8(tag);
-	    size_t sz = strlen(sb) + strlen(st) + 1;
-	    char *cbuf = R_AllocStringBuffer(sz, &cbuff);
-	    snprintf(cbuf, sz + 1, "%s.%s", sb, st);
-	    ans = mkCharCE(cbuf, CE_UTF8);
+	    ans = pasteName(translateCharUTF8(base), translateCharUTF8(tag), 0);
 	    vmaxset(vmax);
 	}
 	else if (count == 1)
 	    ans = base;
 	else {
 	    const void *vmax = vmaxget();
-	    const char *sb = translateCharUTF8(base);
-	    char *cbuf;
-	    size_t sz = strlen(sb) + (size_t) IndexWidth(seqno) + 1;
-	    cbuf = R_AllocStringBuffer(sz, &cbuff);
-#ifdef LONG_VECTOR_SUPPORT
-	    if (seqno > INT_MAX)
-		snprintf(cbuf, sz + 1, "%s%.0f", sb, (double) seqno);
-	    else
-#endif
-		snprintf(cbuf, sz + 1, "%s%d", sb, (int) seqno);
-	    ans = mkCharCE(cbuf, CE_UTF8);
+	    ans = pasteName(translateCharUTF8(base), NULL, seqno);
 	    vmaxset(vmax);
 	}
     }
@@ -1632,9 +1619,14 @@ static SEXP rbind(SEXP call, SEXP args, SEXPTYPE mode, SEXP rho,
 			FILL_MATRIX_ITERATE(n, rows, idx, cols, k)
 			    LOGICAL(result)[didx] = RAW(u)[sidx] ? TRUE : FALSE;
 		    }
-		    else
+		    else if (mode == INTSXP) {
 			FILL_MATRIX_ITERATE(n, rows, idx, cols, k)
 			    INTEGER(result)[didx] = (unsigned char) RAW(u)[sidx];
+		    }
+		    else
+			FILL_MATRIX_ITERATE(n, rows, idx, cols, k)
+			    REAL(result)[didx] = (unsigned char) RAW(u)[sidx];
+		    n += idx;
 		}
 	    }
 	}
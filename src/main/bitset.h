@@ -0,0 +1,81 @@
+/*
+ *  R : A Computer Language for Statistical Data Analysis
+ *  Copyright (C) 2024	    The R Core Team.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, a copy is available at
+ *  https://www.R-project.org/Licenses/
+ */
+
+#ifndef R_BITSET_H
+#define R_BITSET_H
+
+/*
+  Bit-packed logical vectors, an ALTREP class defined in altclasses.c.
+
+  Element i is stored as bit i % 64 of word i / 64 of two bit vectors,
+  each a RAWSXP holding R_BITSET_WORDS(n) 64-bit words: 'bits' has the
+  bit set for TRUE and 'nas' for NA (the 'bits' bit being zero then).
+  'nas' is R_NilValue if there are no NAs.  Bits beyond the length are
+  zero, so counts can be taken over whole words.
+
+  Bit-packed vectors are created for long results of comparisons and
+  logical operators when options(bitset.logical) is true, and are
+  expanded to an ordinary logical vector when a data pointer is needed.
+  R_bitset_logical_words() gives access to the words of a vector that
+  has not been expanded, for code that can work on them directly.
+*/
+
+#define R_BITSET_MIN_N 65536
+#define R_BITSET_WORDS(n) (((n) + 63) / 64)
+#define R_BITSET_ALLOC(n) \
+    allocVector(RAWSXP, R_BITSET_WORDS(n) * sizeof(uint64_t))
+#define R_BITSET_PTR(v) ((uint64_t *) RAW(v))
+#define R_BITSET_GET(w, i) ((int) (((w)[(i) >> 6] >> ((i) & 63)) & 1))
+
+SEXP R_bitset_logical(R_xlen_t n, SEXP bits, SEXP nas);
+Rboolean R_bitset_logical_words(SEXP x, const uint64_t **bits,
+				const uint64_t **nas);
+
+static R_INLINE int R_bitset_popcount(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(w);
+#else
+    int n = 0;
+    for (; w; w &= w - 1) n++;
+    return n;
+#endif
+}
+
+/* index of the lowest set bit, w != 0 */
+static R_INLINE int R_bitset_ctz(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(w);
+#else
+    int n = 0;
+    for (; !(w & 1); w >>= 1) n++;
+    return n;
+#endif
+}
+
+static R_INLINE R_xlen_t R_bitset_count(const uint64_t *w, R_xlen_t n)
+{
+    R_xlen_t cnt = 0, nw = R_BITSET_WORDS(n);
+    for (R_xlen_t k = 0; k < nw; k++)
+	cnt += R_bitset_popcount(w[k]);
+    return cnt;
+}
+
+#endif /* R_BITSET_H */
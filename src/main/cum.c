@@ -24,6 +24,10 @@
 
 #include <Defn.h>
 #include <Internal.h>
+#include <R_ext/Itermacros.h>
+
+/* The real and integer versions read x by regions, so ALTREP inputs
+   (such as deferred arithmetic results) are not expanded. */
 
 /* Handle NaN and NA in input for a cumulative operation, preserving
    distinction between NA and NaN. */
@@ -31,45 +35,77 @@ static SEXP handleNaN(SEXP x, SEXP s)
 {
     Rboolean hasNA = FALSE;
     Rboolean hasNaN = FALSE;
-    double *rx = REAL(x), *rs = REAL(s);
+    double *rs = REAL(s);
 
-    for (R_xlen_t i = 0 ; i < XLENGTH(x) ; i++) {
-	hasNaN = hasNaN || ISNAN(rx[i]);
-	hasNA = hasNA || (hasNaN && R_IsNA(rx[i]));
+    ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    hasNaN = hasNaN || ISNAN(rx[k]);
+	    hasNA = hasNA || (hasNaN && R_IsNA(rx[k]));
 
-	if (hasNA)
-	    rs[i] = NA_REAL;
-	else if (hasNaN)
-	    rs[i] = R_NaN;
-    }
+	    if (hasNA)
+		rs[idx + k] = NA_REAL;
+	    else if (hasNaN)
+		rs[idx + k] = R_NaN;
+	}
+    });
     return s;
 }
 
 static SEXP cumsum(SEXP x, SEXP s)
 {
-    LDOUBLE sum = 0.;
-    double *rx = REAL(x), *rs = REAL(s);
-    for (R_xlen_t i = 0 ; i < XLENGTH(x) ; i++) {
-	sum += rx[i]; /* NA and NaN propagated */
-	rs[i] = (double) sum;
+    double *rs = REAL(s);
+    if (R_Summation == SUMMATION_DOUBLE) {
+	double sum = 0.;
+	ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+	    for (R_xlen_t k = 0; k < nb; k++) {
+		sum += rx[k];
+		rs[idx + k] = sum;
+	    }
+	});
+	return ISNAN(sum) ? handleNaN(x, s) : s;
+    }
+    if (R_Summation != SUMMATION_LDOUBLE) {
+	/* Prefix sums cannot be formed pairwise, so "pairwise" uses
+	   (Kahan-Babuska-Neumaier) compensated summation too. */
+	double sum = 0., c = 0.;
+	ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+	    for (R_xlen_t k = 0; k < nb; k++) {
+		double t = sum + rx[k];
+		c += fabs(sum) >= fabs(rx[k]) ?
+		    (sum - t) + rx[k] : (rx[k] - t) + sum;
+		sum = t;
+		/* once the sum is not finite, it stays so and c is NaN */
+		rs[idx + k] = R_FINITE(sum) ? sum + c : sum;
+	    }
+	});
+	return ISNAN(sum) ? handleNaN(x, s) : s;
     }
+    LDOUBLE sum = 0.;
+    ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    sum += rx[k]; /* NA and NaN propagated */
+	    rs[idx + k] = (double) sum;
+	}
+    });
     return ISNAN(sum) ? handleNaN(x, s) : s;
 }
 
 /* We need to ensure that overflow gives NA here */
 static SEXP icumsum(SEXP x, SEXP s)
 {
-    int *ix = INTEGER(x), *is = INTEGER(s);
+    int *is = INTEGER(s);
     double sum = 0.0;
-    for (R_xlen_t i = 0 ; i < XLENGTH(x) ; i++) {
-	if (ix[i] == NA_INTEGER) break;
-	sum += ix[i];
-	if(sum > INT_MAX || sum < 1 + INT_MIN) { /* INT_MIN is NA_INTEGER */
-	    warning(_("integer overflow in 'cumsum'; use 'cumsum(as.numeric(.))'"));
-	    break;
+    ITERATE_BY_REGION(x, ix, idx, nb, int, INTEGER, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    if (ix[k] == NA_INTEGER) return s;
+	    sum += ix[k];
+	    if(sum > INT_MAX || sum < 1 + INT_MIN) { /* INT_MIN is NA_INTEGER */
+		warning(_("integer overflow in 'cumsum'; use 'cumsum(as.numeric(.))'"));
+		return s;
+	    }
+	    is[idx + k] = (int) sum;
 	}
-	is[i] = (int) sum;
-    }
+    });
     return s;
 }
 
@@ -111,12 +147,14 @@ static SEXP ccumsum(SEXP x, SEXP s)
 static SEXP cumprod(SEXP x, SEXP s)
 {
     LDOUBLE prod;
-    double *rx = REAL(x), *rs = REAL(s);
+    double *rs = REAL(s);
     prod = 1.0;
-    for (R_xlen_t i = 0 ; i < XLENGTH(x) ; i++) {
-	prod *= rx[i]; /* NA and NaN propagated */
-	rs[i] = (double) prod;
-    }
+    ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    prod *= rx[k]; /* NA and NaN propagated */
+	    rs[idx + k] = (double) prod;
+	}
+    });
     return ISNAN(prod) ? handleNaN(x, s) : s;
 }
 
@@ -138,55 +176,57 @@ static SEXP ccumprod(SEXP x, SEXP s)
 
 static SEXP cummax(SEXP x, SEXP s)
 {
-    double max, *rx = REAL(x), *rs = REAL(s);
+    double max, *rs = REAL(s);
     max = R_NegInf;
-    for (R_xlen_t i = 0 ; i < XLENGTH(x) ; i++) {
-	if (ISNAN(rx[i]))
-	    return handleNaN(x, s);
-	else
-	    max = (max > rx[i]) ? max : rx[i];
-	rs[i] = max;
-    }
+    ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    if (ISNAN(rx[k]))
+		return handleNaN(x, s);
+	    else
+		max = (max > rx[k]) ? max : rx[k];
+	    rs[idx + k] = max;
+	}
+    });
     return s;
 }
 
 static SEXP cummin(SEXP x, SEXP s)
 {
-    double min, *rx = REAL(x), *rs = REAL(s);
+    double min, *rs = REAL(s);
     min = R_PosInf; /* always positive, not NA */
-    for (R_xlen_t i = 0 ; i < XLENGTH(x) ; i++ ) {
-	if (ISNAN(rx[i]))
-	    return handleNaN(x, s);
-	else
-	    min = (min < rx[i]) ? min : rx[i];
-	rs[i] = min;
-    }
+    ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    if (ISNAN(rx[k]))
+		return handleNaN(x, s);
+	    else
+		min = (min < rx[k]) ? min : rx[k];
+	    rs[idx + k] = min;
+	}
+    });
     return s;
 }
 
 static SEXP icummax(SEXP x, SEXP s)
 {
-    int *ix = INTEGER(x);
-    if(ix[0] == NA_INTEGER)
-	return s; // all NA
-    int *is = INTEGER(s), max = ix[0];
-    is[0] = max;
-    for (R_xlen_t i = 1 ; i < XLENGTH(x) ; i++) {
-	if(ix[i] == NA_INTEGER) break;
-	is[i] = max = (max > ix[i]) ? max : ix[i];
-    }
+    int *is = INTEGER(s), max = INTEGER_ELT(x, 0);
+    ITERATE_BY_REGION(x, ix, idx, nb, int, INTEGER, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    if(ix[k] == NA_INTEGER) return s; // the rest is NA
+	    is[idx + k] = max = (max > ix[k]) ? max : ix[k];
+	}
+    });
     return s;
 }
 
 static SEXP icummin(SEXP x, SEXP s)
 {
-    int *ix = INTEGER(x), *is = INTEGER(s);
-    int min = ix[0];
-    is[0] = min;
-    for (R_xlen_t i = 1 ; i < XLENGTH(x) ; i++ ) {
-	if(ix[i] == NA_INTEGER) break;
-	is[i] = min = (min < ix[i]) ? min : ix[i];
-    }
+    int *is = INTEGER(s), min = INTEGER_ELT(x, 0);
+    ITERATE_BY_REGION(x, ix, idx, nb, int, INTEGER, {
+	for (R_xlen_t k = 0; k < nb; k++) {
+	    if(ix[k] == NA_INTEGER) return s; // the rest is NA
+	    is[idx + k] = min = (min < ix[k]) ? min : ix[k];
+	}
+    });
     return s;
 }
 
@@ -197,6 +237,10 @@ attribute_hidden SEXP do_cum(SEXP call, SEXP op, SEXP args, SEXP env)
     checkArity(op, args);
     if (DispatchGroup("Math", call, op, args, env, &ans))
 	return ans;
+    /* compact sequences have closed forms */
+    if (ALTREP(CAR(args)) &&
+	(ans = R_compact_cum(CAR(args), PRIMVAL(op))) != NULL)
+	return ans;
     if (isComplex(CAR(args))) {
 	t = CAR(args);
 	n = XLENGTH(t);
@@ -484,13 +484,65 @@ void copyMatrix(SEXP s, SEXP t, Rboolean byrow)
 	copyVector(s, t);
 }
 
+/* Copies without recycling, as made by cbind() and rbind() into large
+   matrices, are done with memcpy: a run of n elements in chunks, and
+   the columns of a matrix into a block of rows of a taller one a
+   column at a time.  For long copies the chunks or columns are spread
+   over R_num_math_threads threads. */
+
+#define COPY_THREADS_MIN_N 1000000
+#define COPY_CHUNK 65536
+
+static R_INLINE int copy_nthreads(R_xlen_t n, R_xlen_t nblocks)
+{
+#ifdef _OPENMP
+    if (n >= COPY_THREADS_MIN_N && nblocks > 1 && R_num_math_threads > 1)
+	return R_num_math_threads;
+#endif
+    return 1;
+}
+
+static void copyRun(void *dst, const void *src, size_t size, R_xlen_t n)
+{
+    R_xlen_t nchunks = (n + COPY_CHUNK - 1) / COPY_CHUNK;
+    int nthreads = copy_nthreads(n, nchunks);
+    if (nthreads == 1) {
+	memcpy(dst, src, n * size);
+	return;
+    }
+    char *d = (char *) dst;
+    const char *s = (const char *) src;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(d, s, size, n, nchunks)
+#endif
+    for (R_xlen_t c = 0; c < nchunks; c++) {
+	R_xlen_t len = c < nchunks - 1 ? COPY_CHUNK : n - c * COPY_CHUNK;
+	memcpy(d + c * COPY_CHUNK * size, s + c * COPY_CHUNK * size,
+	       len * size);
+    }
+}
+
+static void copyColumns(void *dst, const void *src, size_t size,
+			R_xlen_t drows, R_xlen_t srows, R_xlen_t cols)
+{
+    char *d = (char *) dst;
+    const char *s = (const char *) src;
+    int nthreads = copy_nthreads(srows * cols, cols);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(d, s, size, drows, srows, cols)
+#endif
+    for (R_xlen_t j = 0; j < cols; j++)
+	memcpy(d + j * drows * size, s + j * srows * size, srows * size);
+}
+
 #define COPY_WITH_RECYCLE(VALTYPE, TNAME) \
 attribute_hidden void \
 xcopy##TNAME##WithRecycle(VALTYPE *dst, VALTYPE *src, R_xlen_t dstart, R_xlen_t n, R_xlen_t nsrc) { \
 							\
     if (nsrc >= n) { /* no recycle needed */		\
-	for(R_xlen_t i = 0; i < n; i++)		\
-	    dst[dstart + i] = src[i];			\
+	copyRun(dst + dstart, src, sizeof(VALTYPE), n);	\
 	return;					\
     }							\
     if (nsrc == 1) {					\
@@ -546,8 +598,12 @@ attribute_hidden void xfill##TNAME##MatrixWithRecycle(VALTYPE *dst, VALTYPE *src
     R_xlen_t dstart, R_xlen_t drows, R_xlen_t srows,		\
     R_xlen_t cols, R_xlen_t nsrc) {				\
 								\
-    FILL_MATRIX_ITERATE(dstart, drows, srows, cols, nsrc)	\
-	dst[didx] = src[sidx];					\
+    if (srows > 1 && nsrc == srows * cols)			\
+	copyColumns(dst + dstart, src, sizeof(VALTYPE),		\
+		    drows, srows, cols);			\
+    else							\
+	FILL_MATRIX_ITERATE(dstart, drows, srows, cols, nsrc)	\
+	    dst[didx] = src[sidx];				\
 }
 
 FILL_WITH_RECYCLE(Rcomplex, Complex)	/* xfillComplexMatrixWithRecycle */
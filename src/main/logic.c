@@ -25,6 +25,7 @@
 #include <Defn.h>
 #include <Internal.h>
 #include <R_ext/Itermacros.h>
+#include "bitset.h"
 
 /* interval at which to check interrupts, a guess */
 /*   if re-enabling, consider a power of two */
@@ -35,6 +36,10 @@ static SEXP lunary(SEXP, SEXP, SEXP);
 static SEXP lbinary(SEXP, SEXP, SEXP);
 static SEXP binaryLogic(int code, SEXP s1, SEXP s2);
 static SEXP binaryLogic2(int code, SEXP s1, SEXP s2);
+static SEXP bitsetLogic(int code, R_xlen_t n,
+			const uint64_t *v1, const uint64_t *m1,
+			const uint64_t *v2, const uint64_t *m2);
+static SEXP bitsetNot(R_xlen_t n, const uint64_t *v, const uint64_t *m);
 
 
 /* & | ! */
@@ -136,9 +141,14 @@ static SEXP lbinary(SEXP call, SEXP op, SEXP args)
 	    warningcall(call,
 			_("longer object length is not a multiple of shorter object length"));
 
+	const uint64_t *xv, *xm, *yv, *ym;
 	if (isRaw(x) && isRaw(y)) {
 	    x = binaryLogic2(PRIMVAL(op), x, y);
 	}
+	else if (nx == ny && R_bitset_logical_words(x, &xv, &xm) &&
+		 R_bitset_logical_words(y, &yv, &ym)) {
+	    x = bitsetLogic(PRIMVAL(op), nx, xv, xm, yv, ym);
+	}
 	else {
 	    if(isNull(x))
 		x = SETCAR(args, allocVector(LGLSXP, 0));
@@ -189,6 +199,13 @@ static SEXP lunary(SEXP call, SEXP op, SEXP arg)
 	if (!len) return allocVector(LGLSXP, 0);
 	errorcall(call, _("invalid argument type"));
     }
+    const uint64_t *av, *am;
+    if (R_bitset_logical_words(arg, &av, &am)) {
+	x = PROTECT(bitsetNot(len, av, am));
+	SHALLOW_DUPLICATE_ATTRIB(x, arg);
+	UNPROTECT(1);
+	return x;
+    }
     if (isLogical(arg) || isRaw(arg))
 	// copy all attributes in this case
 	x = PROTECT(shallow_duplicate(arg));
@@ -321,6 +338,57 @@ attribute_hidden SEXP do_logic2(SEXP call, SEXP op, SEXP args, SEXP env)
     return ScalarLogical(ans);
 }
 
+/* & and | of bit-packed logical vectors of the same length (see
+   bitset.h), a word at a time.  The m* are NULL if there are no NAs. */
+static SEXP bitsetLogic(int code, R_xlen_t n,
+			const uint64_t *v1, const uint64_t *m1,
+			const uint64_t *v2, const uint64_t *m2)
+{
+    R_xlen_t nw = R_BITSET_WORDS(n);
+    uint64_t anyna = 0;
+    SEXP bits = PROTECT(R_BITSET_ALLOC(n));
+    SEXP nas = PROTECT(R_BITSET_ALLOC(n));
+    uint64_t *pv = R_BITSET_PTR(bits), *pm = R_BITSET_PTR(nas);
+
+    for (R_xlen_t w = 0; w < nw; w++) {
+	uint64_t a = v1[w], b = v2[w];
+	uint64_t na = (m1 ? m1[w] : 0) | (m2 ? m2[w] : 0);
+	if (code == 1) { /* & : NA unless either is FALSE */
+	    uint64_t f = ~(a | (m1 ? m1[w] : 0)) | ~(b | (m2 ? m2[w] : 0));
+	    pv[w] = a & b;
+	    pm[w] = na & ~f;
+	}
+	else { /* | : NA unless either is TRUE */
+	    pv[w] = a | b;
+	    pm[w] = na & ~(a | b);
+	}
+	anyna |= pm[w];
+    }
+    SEXP ans = R_bitset_logical(n, bits, anyna ? nas : R_NilValue);
+    UNPROTECT(2); /* bits, nas */
+    return ans;
+}
+
+static SEXP bitsetNot(R_xlen_t n, const uint64_t *v, const uint64_t *m)
+{
+    R_xlen_t nw = R_BITSET_WORDS(n);
+    SEXP bits = PROTECT(R_BITSET_ALLOC(n));
+    SEXP nas = R_NilValue;
+    uint64_t *pv = R_BITSET_PTR(bits);
+    for (R_xlen_t w = 0; w < nw; w++)
+	pv[w] = ~(v[w] | (m ? m[w] : 0));
+    if (n % 64) /* keep the bits beyond the length zero */
+	pv[nw - 1] &= ((uint64_t) 1 << (n % 64)) - 1;
+    if (m != NULL) {
+	nas = R_BITSET_ALLOC(n);
+	memcpy(R_BITSET_PTR(nas), m, nw * sizeof(uint64_t));
+    }
+    PROTECT(nas);
+    SEXP ans = R_bitset_logical(n, bits, nas);
+    UNPROTECT(2); /* bits, nas */
+    return ans;
+}
+
 static SEXP binaryLogic(int code, SEXP s1, SEXP s2)
 {
     R_xlen_t i, n, n1, n2, i1, i2;
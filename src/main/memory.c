@@ -1359,19 +1359,10 @@ static SEXP R_weak_refs = NULL;
 
 static SEXP MakeCFinalizer(R_CFinalizer_t cfun);
 
-static SEXP NewWeakRef(SEXP key, SEXP val, SEXP fin, Rboolean onexit)
+static SEXP NewWeakRef0(SEXP key, SEXP val, SEXP fin, Rboolean onexit)
 {
     SEXP w;
 
-    switch (TYPEOF(key)) {
-    case NILSXP:
-    case ENVSXP:
-    case EXTPTRSXP:
-    case BCODESXP:
-	break;
-    default: error(_("can only weakly reference/finalize reference objects"));
-    }
-
     PROTECT(key);
     PROTECT(val = MAYBE_REFERENCED(val) ? duplicate(val) : val);
     PROTECT(fin);
@@ -1395,6 +1386,26 @@ static SEXP NewWeakRef(SEXP key, SEXP val, SEXP fin, Rboolean onexit)
     return w;
 }
 
+static SEXP NewWeakRef(SEXP key, SEXP val, SEXP fin, Rboolean onexit)
+{
+    switch (TYPEOF(key)) {
+    case NILSXP:
+    case ENVSXP:
+    case EXTPTRSXP:
+    case BCODESXP:
+	break;
+    default: error(_("can only weakly reference/finalize reference objects"));
+    }
+    return NewWeakRef0(key, val, fin, onexit);
+}
+
+/* Weak references keyed by a vector, for internal caches keyed by the
+   identity of the vector, such as the hash indices in unique.c. */
+attribute_hidden SEXP R_MakeVectorWeakRef(SEXP key, SEXP val)
+{
+    return NewWeakRef0(key, val, R_NilValue, FALSE);
+}
+
 SEXP R_MakeWeakRef(SEXP key, SEXP val, SEXP fin, Rboolean onexit)
 {
     switch (TYPEOF(fin)) {
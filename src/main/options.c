@@ -78,6 +78,14 @@
  *	"nwarnings"
 
  *	"matprod"
+ *	"deferred.arith"
+ *	"summation"		./summary.c
+ *	"bitset.logical"	./altclasses.c
+ *	"collation.keys"	./util.c
+ *	"hash.index"		./unique.c
+ *	"subset.views"		./subset.c
+ *	"rep.lazy"		./altclasses.c
+ *	"apply.threads"		./apply.c
  *      "PCRE_study"
  *      "PCRE_use_JIT"
 
@@ -278,9 +286,9 @@ attribute_hidden void InitOptions(void)
 
     /* options set here should be included into mandatory[] in do_options */
 #ifdef HAVE_RL_COMPLETION_MATCHES
-    PROTECT(v = val = allocList(30));
+    PROTECT(v = val = allocList(38));
 #else
-    PROTECT(v = val = allocList(29));
+    PROTECT(v = val = allocList(37));
 #endif
 
     SET_TAG(v, install("prompt"));
@@ -368,6 +376,65 @@ attribute_hidden void InitOptions(void)
     SETCAR(v, mkString(p));
     v = CDR(v);
 
+    p = getenv("R_DEFERRED_ARITH");
+    R_DeferredArith = (p && (strcmp(p, "yes") == 0)) ? TRUE : FALSE;
+
+    SET_TAG(v, install("deferred.arith"));
+    SETCAR(v, ScalarLogical(R_DeferredArith));
+    v = CDR(v);
+
+    SET_TAG(v, install("summation"));
+    switch(R_Summation) {
+	case SUMMATION_LDOUBLE: p = "ldouble"; break;
+	case SUMMATION_DOUBLE: p = "double"; break;
+	case SUMMATION_PAIRWISE: p = "pairwise"; break;
+	case SUMMATION_KAHAN: p = "kahan"; break;
+    }
+    SETCAR(v, mkString(p));
+    v = CDR(v);
+
+    p = getenv("R_BITSET_LOGICAL");
+    R_BitsetLogical = (p && (strcmp(p, "yes") == 0)) ? TRUE : FALSE;
+
+    SET_TAG(v, install("bitset.logical"));
+    SETCAR(v, ScalarLogical(R_BitsetLogical));
+    v = CDR(v);
+
+    p = getenv("R_COLLATION_KEYS");
+    R_CollationKeys = (p && (strcmp(p, "yes") == 0)) ? TRUE : FALSE;
+
+    SET_TAG(v, install("collation.keys"));
+    SETCAR(v, ScalarLogical(R_CollationKeys));
+    v = CDR(v);
+
+    p = getenv("R_HASH_INDEX");
+    R_HashIndex = (p && (strcmp(p, "yes") == 0)) ? TRUE : FALSE;
+
+    SET_TAG(v, install("hash.index"));
+    SETCAR(v, ScalarLogical(R_HashIndex));
+    v = CDR(v);
+
+    p = getenv("R_SUBSET_VIEWS");
+    R_SubsetViews = (p && (strcmp(p, "yes") == 0)) ? TRUE : FALSE;
+
+    SET_TAG(v, install("subset.views"));
+    SETCAR(v, ScalarLogical(R_SubsetViews));
+    v = CDR(v);
+
+    p = getenv("R_REP_LAZY");
+    R_RepLazy = (p && (strcmp(p, "yes") == 0)) ? TRUE : FALSE;
+
+    SET_TAG(v, install("rep.lazy"));
+    SETCAR(v, ScalarLogical(R_RepLazy));
+    v = CDR(v);
+
+    p = getenv("R_APPLY_THREADS");
+    R_ApplyThreads = (p && (strcmp(p, "no") == 0)) ? FALSE : TRUE;
+
+    SET_TAG(v, install("apply.threads"));
+    SETCAR(v, ScalarLogical(R_ApplyThreads));
+    v = CDR(v);
+
     SET_TAG(v, install("PCRE_study"));
     if (R_PCRE_study == -1)
 	SETCAR(v, ScalarLogical(TRUE));
@@ -556,8 +623,11 @@ attribute_hidden SEXP do_options(SEXP call, SEXP op, SEXP args, SEXP rho)
 		  "check.bounds", "keep.source", "keep.source.pkgs",
 		  "keep.parse.data", "keep.parse.data.pkgs", "warning.length",
 		  "nwarnings", "OutDec", "browserNLdisabled", "CBoundsCheck",
-		  "matprod", "PCRE_study", "PCRE_use_JIT",
-		  "PCRE_limit_recursion", "rl_word_breaks",
+		  "matprod", "deferred.arith", "summation", "bitset.logical",
+		  "collation.keys", "hash.index", "subset.views", "rep.lazy",
+		  "apply.threads",
+		  "PCRE_study", "PCRE_use_JIT", "PCRE_limit_recursion",
+		  "rl_word_breaks",
 		  "max.contour.segments", "warnPartialMatchDollar",
 		  "warnPartialMatchArgs", "warnPartialMatchAttr",
 		  "showWarnCalls", "showErrorCalls", "showNCalls",
@@ -817,6 +887,80 @@ attribute_hidden SEXP do_options(SEXP call, SEXP op, SEXP args, SEXP rho)
 		    error(_("invalid value for '%s'"), CHAR(namei));
 		SET_VECTOR_ELT(value, i, SetOption(tag, duplicate(argi)));
 	    }
+	    else if (streql(CHAR(namei), "deferred.arith")) {
+		if (TYPEOF(argi) != LGLSXP || LENGTH(argi) != 1 ||
+		    LOGICAL(argi)[0] == NA_LOGICAL)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		int k = asLogical(argi);
+		R_DeferredArith = k;
+		SET_VECTOR_ELT(value, i, SetOption(tag, ScalarLogical(k)));
+	    }
+	    else if (streql(CHAR(namei), "summation")) {
+		SEXP s = asChar(argi);
+		if (s == NA_STRING || LENGTH(s) == 0)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		if (streql(CHAR(s), "ldouble"))
+		    R_Summation = SUMMATION_LDOUBLE;
+		else if (streql(CHAR(s), "double"))
+		    R_Summation = SUMMATION_DOUBLE;
+		else if (streql(CHAR(s), "pairwise"))
+		    R_Summation = SUMMATION_PAIRWISE;
+		else if (streql(CHAR(s), "kahan"))
+		    R_Summation = SUMMATION_KAHAN;
+		else
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		SET_VECTOR_ELT(value, i, SetOption(tag, duplicate(argi)));
+	    }
+	    else if (streql(CHAR(namei), "bitset.logical")) {
+		if (TYPEOF(argi) != LGLSXP || LENGTH(argi) != 1 ||
+		    LOGICAL(argi)[0] == NA_LOGICAL)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		int k = asLogical(argi);
+		R_BitsetLogical = k;
+		SET_VECTOR_ELT(value, i, SetOption(tag, ScalarLogical(k)));
+	    }
+	    else if (streql(CHAR(namei), "collation.keys")) {
+		if (TYPEOF(argi) != LGLSXP || LENGTH(argi) != 1 ||
+		    LOGICAL(argi)[0] == NA_LOGICAL)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		int k = asLogical(argi);
+		R_CollationKeys = k;
+		if (!k) R_resetCollationKeys();
+		SET_VECTOR_ELT(value, i, SetOption(tag, ScalarLogical(k)));
+	    }
+	    else if (streql(CHAR(namei), "hash.index")) {
+		if (TYPEOF(argi) != LGLSXP || LENGTH(argi) != 1 ||
+		    LOGICAL(argi)[0] == NA_LOGICAL)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		int k = asLogical(argi);
+		R_HashIndex = k;
+		if (!k) R_resetHashIndex();
+		SET_VECTOR_ELT(value, i, SetOption(tag, ScalarLogical(k)));
+	    }
+	    else if (streql(CHAR(namei), "subset.views")) {
+		if (TYPEOF(argi) != LGLSXP || LENGTH(argi) != 1 ||
+		    LOGICAL(argi)[0] == NA_LOGICAL)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		int k = asLogical(argi);
+		R_SubsetViews = k;
+		SET_VECTOR_ELT(value, i, SetOption(tag, ScalarLogical(k)));
+	    }
+	    else if (streql(CHAR(namei), "rep.lazy")) {
+		if (TYPEOF(argi) != LGLSXP || LENGTH(argi) != 1 ||
+		    LOGICAL(argi)[0] == NA_LOGICAL)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		int k = asLogical(argi);
+		R_RepLazy = k;
+		SET_VECTOR_ELT(value, i, SetOption(tag, ScalarLogical(k)));
+	    }
+	    else if (streql(CHAR(namei), "apply.threads")) {
+		if (TYPEOF(argi) != LGLSXP || LENGTH(argi) != 1 ||
+		    LOGICAL(argi)[0] == NA_LOGICAL)
+		    error(_("invalid value for '%s'"), CHAR(namei));
+		int k = asLogical(argi);
+		R_ApplyThreads = k;
+		SET_VECTOR_ELT(value, i, SetOption(tag, ScalarLogical(k)));
+	    }
 	    else if (streql(CHAR(namei), "PCRE_study")) {
 		if (TYPEOF(argi) == LGLSXP) {
 		    int k = asLogical(argi) > 0;
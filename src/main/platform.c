@@ -2179,6 +2179,8 @@ attribute_hidden SEXP do_setlocale(SEXP call, SEXP op, SEXP args, SEXP rho)
     case 3:
 	cat = LC_CTYPE;
 	p = setlocale(cat, CHAR(STRING_ELT(locale, 0)));
+	/* keys are computed from strings in the native encoding */
+	R_resetCollationKeys();
 	break;
     case 4:
 	cat = LC_MONETARY;
@@ -27,6 +27,8 @@
 #include <Defn.h>
 #include <Internal.h>
 
+#include <stdint.h>
+
 /* It would be better to find a way to avoid abusing TRUELENGTH, but
    in the meantime replace TRUELENGTH/SET_TRUELENGTH with
    TRLEN/SET_TRLEN that cast to int to avoid warnings. */
@@ -63,6 +65,129 @@ static int order = 1;
 // (see setRange for details)
 #define N_RANGE 100000
 
+/* The string bookkeeping of cgroup() and csort() is kept in the
+   TRUELENGTH of the CHARSXPs (saving and restoring any other use) when
+   the sort is sequential, as that is the cheapest.  When threads may
+   be used (strtl is FALSE) it is kept in a side table instead: an
+   open-addressing hash table from CHARSXP pointers to an int, which is
+   0 for strings not in the table.  The CHARSXPs are not touched, and
+   lookups (stab_get) do not change the table, so they can be done from
+   several threads once it is built.
+
+   A slot is in use if its generation is the current one, so the table
+   is emptied in constant time by starting a new generation, as
+   cgroup() does for every group. */
+typedef struct {
+    SEXP key;
+    int val;
+    unsigned int gen;
+} stab_entry;  // one cache line access per probe
+
+static stab_entry *stab = NULL;
+static unsigned int stab_curgen = 1;
+static int stab_bits = 0;
+static size_t stab_n = 0;
+
+#define STAB_MIN_BITS 10
+
+static R_INLINE size_t stab_hash(SEXP s, int bits)
+{
+    return (size_t) ((((uintptr_t) s >> 3) * 0x9E3779B97F4A7C15ULL)
+		     >> (64 - bits));
+}
+
+static void stab_free(void)
+{
+    free(stab);  // does nothing on NULL input
+    stab = NULL;
+    stab_curgen = 1;
+    stab_bits = 0;
+    stab_n = 0;
+}
+
+static void stab_alloc(int bits)
+{
+    stab_entry *old = stab;
+    unsigned int oldgen = stab_curgen;
+    size_t oldsize = old ? (size_t) 1 << stab_bits : 0;
+    size_t size = (size_t) 1 << bits;
+    stab = (stab_entry *) calloc(size, sizeof(stab_entry));
+    if (stab == NULL) {
+	free(old);
+	stab_free();
+	error("Failed to allocate working memory for the string table");
+    }
+    stab_bits = bits;
+    stab_curgen = 1;
+    for (size_t i = 0; i < oldsize; i++)
+	if (old[i].gen == oldgen) {
+	    size_t k = stab_hash(old[i].key, bits);
+	    while (stab[k].gen == stab_curgen)
+		k = (k + 1) & (size - 1);
+	    stab[k].key = old[i].key;
+	    stab[k].val = old[i].val;
+	    stab[k].gen = stab_curgen;
+	}
+    free(old);
+}
+
+// the value for s, added as 0 if not there
+static int *stab_slot(SEXP s)
+{
+    if (stab == NULL)
+	stab_alloc(STAB_MIN_BITS);
+    else if (2 * (stab_n + 1) > (size_t) 1 << stab_bits)
+	stab_alloc(stab_bits + 1);
+    size_t mask = ((size_t) 1 << stab_bits) - 1;
+    size_t k = stab_hash(s, stab_bits);
+    for (; stab[k].gen == stab_curgen; k = (k + 1) & mask)
+	if (stab[k].key == s)
+	    return &stab[k].val;
+    stab[k].key = s;
+    stab[k].val = 0;
+    stab[k].gen = stab_curgen;
+    stab_n++;
+    return &stab[k].val;
+}
+
+// the value for s, which is in the table
+static R_INLINE int *stab_find(SEXP s)
+{
+    stab_entry *tab = stab;
+    int bits = stab_bits;
+    unsigned int gen = stab_curgen;
+    size_t mask = ((size_t) 1 << bits) - 1;
+    size_t k = stab_hash(s, bits);
+    while (tab[k].key != s || tab[k].gen != gen)
+	k = (k + 1) & mask;
+    return &tab[k].val;
+}
+
+static R_INLINE int stab_get(SEXP s)
+{
+    stab_entry *tab = stab;
+    if (tab == NULL)
+	return 0;
+    int bits = stab_bits;
+    unsigned int gen = stab_curgen;
+    size_t mask = ((size_t) 1 << bits) - 1;
+    for (size_t k = stab_hash(s, bits); tab[k].gen == gen; k = (k + 1) & mask)
+	if (tab[k].key == s)
+	    return tab[k].val;
+    return 0;
+}
+
+static void stab_clear(void)
+{
+    stab_n = 0;
+    if (++stab_curgen == 0) { // wrapped around
+	if (stab != NULL)
+	    memset(stab, 0, ((size_t) 1 << stab_bits) * sizeof(stab_entry));
+	stab_curgen = 1;
+    }
+}
+
+static Rboolean strtl = TRUE;
 static SEXP *saveds = NULL;
 static R_len_t *savedtl = NULL, nalloc = 0, nsaved = 0;
 
@@ -123,12 +248,12 @@ static void savetl(SEXP s)
 }
 
 // http://gcc.gnu.org/onlinedocs/cpp/Swallowing-the-Semicolon.html#Swallowing-the-Semicolon
-#define Error(...) do {savetl_end(); error(__VA_ARGS__);} while(0)
+#define Error(...) do {savetl_end(); stab_free(); error(__VA_ARGS__);} while(0)
 #undef warning
 // since it can be turned to error via warn = 2
 #define warning(...) Do not use warning in this file
 /* use malloc/realloc (not Calloc/Realloc) so we can trap errors
-   and call savetl_end() before the error(). */
+   and call savetl_end() and stab_free() before the error(). */
 
 static void growstack(uint64_t newlen)
 {
@@ -358,6 +483,135 @@ static void iinsert(int *x, int *o, int n)
     push(tt + 1);
 }
 
+/*
+  Parallel LSD radix sort.
+
+  For long vectors iradix() and dradix() (and so csort(), which sorts
+  the ranks of the strings) use R_num_math_threads threads when that
+  is more than one.  The twiddled keys are sorted least significant
+  byte first, skipping bytes which are the same for all keys.  Each
+  pass cuts the keys into one contiguous block per thread, counts the
+  byte in each block and then moves each block to its own offsets,
+  so every pass is stable and the result is the same as that of the
+  sequential MSD sort, whatever the number of threads.  Group sizes
+  are then pushed from the runs of equal keys.
+
+  This needs working memory for two copies of the keys and one of the
+  order; if that cannot be allocated the sequential sort is used.
+*/
+#define RADIX_THREADS_MIN_N 100000
+
+static int radix_nthreads(int n)
+{
+#ifdef _OPENMP
+    if (n >= RADIX_THREADS_MIN_N && R_num_math_threads > 1)
+	return R_num_math_threads;
+#endif
+    return 1;
+}
+
+#define RADIX_BLOCK_START(n, nb, b) ((int) ((int64_t) (n) * (b) / (nb)))
+
+// sorts key and places the ordering into o, both of length n, using
+// the nbytes low bytes of the keys.
+static Rboolean lsd_radix(uint64_t *key, int *o, int n, int nbytes,
+			  int nthreads)
+{
+    int nb = nthreads;
+    uint64_t *key2 = (uint64_t *) malloc((size_t) n * sizeof(uint64_t));
+    int *o2 = (int *) malloc((size_t) n * sizeof(int));
+    unsigned int *cnt = (unsigned int *)
+	calloc((size_t) nb * nbytes * 256, sizeof(unsigned int));
+    if (key2 == NULL || o2 == NULL || cnt == NULL) {
+	free(key2); free(o2); free(cnt);
+	return FALSE;
+    }
+    uint64_t *kx = key, *ky = key2;
+    int *ox = o, *oy = o2;
+
+    // counts of all bytes in each block, in one pass
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(kx, ox, cnt, n, nb, nbytes)
+#endif
+    for (int b = 0; b < nb; b++) {
+	unsigned int *c = cnt + (size_t) b * nbytes * 256;
+	int end = RADIX_BLOCK_START(n, nb, b + 1);
+	for (int i = RADIX_BLOCK_START(n, nb, b); i < end; i++) {
+	    uint64_t v = kx[i];
+	    for (int d = 0; d < nbytes; d++)
+		c[d * 256 + (v >> (8 * d) & 0xFF)]++;
+	    ox[i] = i + 1;
+	}
+    }
+
+    Rboolean counted = TRUE; // are the block counts for the current order?
+    for (int d = 0; d < nbytes; d++) {
+	// skip the byte if all the keys have it, e.g. the last key
+	int last = (int) (kx[n - 1] >> (8 * d) & 0xFF);
+	unsigned int total = 0;
+	for (int b = 0; b < nb; b++)
+	    total += cnt[((size_t) b * nbytes + d) * 256 + last];
+	if (total == (unsigned int) n)
+	    continue;
+	if (!counted) {
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(kx, cnt, n, nb, nbytes, d)
+#endif
+	    for (int b = 0; b < nb; b++) {
+		unsigned int *c = cnt + ((size_t) b * nbytes + d) * 256;
+		int end = RADIX_BLOCK_START(n, nb, b + 1);
+		memset(c, 0, 256 * sizeof(unsigned int));
+		for (int i = RADIX_BLOCK_START(n, nb, b); i < end; i++)
+		    c[kx[i] >> (8 * d) & 0xFF]++;
+	    }
+	}
+	// turn the counts into offsets: by byte value, then block
+	unsigned int pos = 0;
+	for (int v = 0; v < 256; v++)
+	    for (int b = 0; b < nb; b++) {
+		unsigned int *c = cnt + ((size_t) b * nbytes + d) * 256 + v;
+		unsigned int t = *c;
+		*c = pos;
+		pos += t;
+	    }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(kx, ky, ox, oy, cnt, n, nb, nbytes, d)
+#endif
+	for (int b = 0; b < nb; b++) {
+	    unsigned int *c = cnt + ((size_t) b * nbytes + d) * 256;
+	    int end = RADIX_BLOCK_START(n, nb, b + 1);
+	    for (int i = RADIX_BLOCK_START(n, nb, b); i < end; i++) {
+		uint64_t v = kx[i];
+		unsigned int j = c[v >> (8 * d) & 0xFF]++;
+		ky[j] = v;
+		oy[j] = ox[i];
+	    }
+	}
+	uint64_t *kt = kx; kx = ky; ky = kt;
+	int *ot = ox; ox = oy; oy = ot;
+	counted = FALSE;
+    }
+    if (ox != o)
+	memcpy(o, ox, (size_t) n * sizeof(int));
+
+    if (stackgrps) {
+	int run = 1;
+	for (int i = 1; i < n; i++)
+	    if (kx[i] == kx[i - 1])
+		run++;
+	    else {
+		push(run);
+		run = 1;
+	    }
+	push(run);
+    }
+    free(key2); free(o2); free(cnt);
+    return TRUE;
+}
+
 /*
   iradix is a counting sort performed forwards from MSB to LSB, with
   some tricks and short circuits building on Terdiman and Herf.
@@ -437,6 +691,27 @@ static void iradix(int *x, int *o, int n)
     int nextradix, itmp, thisgrpn, maxgrpn;
     unsigned int thisx = 0, shift, *thiscounts;
 
+    int nthreads = radix_nthreads(n);
+    if (nthreads > 1) {
+	uint64_t *key = (uint64_t *) malloc((size_t) n * sizeof(uint64_t));
+	if (key != NULL) {
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(x, key, n)
+#endif
+	    for (int i = 0; i < n; i++)
+		key[i] = (unsigned int) (icheck(x[i])) - INT_MIN;
+	    Rboolean done = lsd_radix(key, o, n, 4, nthreads);
+	    free(key);
+	    if (done) {
+		if (nalast == 0)
+		    for (int i = 0; i < n; i++)
+			o[i] = (x[o[i] - 1] == NA_INTEGER) ? 0 : o[i];
+		return;
+	    }
+	}
+    }
+
     for (int i = 0; i < n;i++) {
 	/* parallel histogramming pass; i.e. count occurrences of
 	   0:255 in each byte.  Sequential so almost negligible. */
@@ -626,14 +901,15 @@ static void setNumericRounding(int dround)
     dmask2 = 0xffffffffffffffff << dround * 8;
 }
 
-static union {
+typedef union {
     double d;
     unsigned long long ull;
-} u;
+} dull;
 
 static
 unsigned long long dtwiddle(void *p, int i, int order)
 {
+    dull u;
     u.d = order * ((double *)p)[i]; // take care of 'order' at the beginning
     if (R_FINITE(u.d)) {
 	u.ull = (u.d != 0.0) ? u.ull + ((u.ull & dmask1) << 1) : 0;
@@ -650,8 +926,7 @@ unsigned long long dtwiddle(void *p, int i, int order)
 
 static Rboolean dnan(void *p, int i)
 {
-    u.d = ((double *) p)[i];
-    return (ISNAN(u.d));
+    return (ISNAN(((double *) p)[i]));
 }
 
 static unsigned long long (*twiddle) (void *, int, int);
@@ -673,6 +948,30 @@ static void dradix(unsigned char *x, int *o, int n)
     int radix, nextradix, itmp, thisgrpn, maxgrpn;
     unsigned int *thiscounts;
     unsigned long long thisx = 0;
+
+    int nthreads = radix_nthreads(n);
+    if (nthreads > 1) {
+	uint64_t *key = (uint64_t *) malloc((size_t) n * sizeof(uint64_t));
+	if (key != NULL) {
+	    unsigned long long (*tw) (void *, int, int) = twiddle;
+	    int ord = order;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(x, key, n, tw, ord)
+#endif
+	    for (int i = 0; i < n; i++)
+		key[i] = tw(x, i, ord);
+	    Rboolean done = lsd_radix(key, o, n, (int) colSize, nthreads);
+	    free(key);
+	    if (done) {
+		if (nalast == 0)
+		    for (int i = 0; i < n; i++)
+			o[i] = is_nan(x, o[i] - 1) ? 0 : o[i];
+		return;
+	    }
+	}
+    }
+
     // see comments in iradix for structure.  This follows the same.
     // TO DO: merge iradix in here (almost ready)
     for (int i = 0; i < n; i++) {
@@ -1048,22 +1347,10 @@ static void cradix_r(SEXP * xsub, int n, int radix)
 static SEXP *ustr = NULL;
 static int ustr_alloc = 0, ustr_n = 0;
 
-static void cgroup(SEXP * x, int *o, int n)
-// As icount :
-//   Places the ordering into o directly, overwriting whatever was there
-//   Doesn't change x
-//   Pushes group sizes onto stack
-
-// Only run when sortStr == FALSE. Basically a counting sort, in first
-// appearance order, directly.  Since it doesn't sort the strings, the
-// name is cgroup.  there is no _pre for this.  ustr created and
-// cleared each time.
+// cgroup() keeping the counts in the TRUELENGTH of the CHARSXPs
+static void cgroup_tl(SEXP * x, int *o, int n)
 {
     // savetl_init() is called once at the start of do_radixsort
-    if (ustr_n != 0)
-	Error
-	    ("Internal error. ustr isn't empty when starting cgroup: ustr_n=%d, ustr_alloc=%d",
-	     ustr_n, ustr_alloc);
     for (int i = 0; i < n; i++) {
 	SEXP s = x[i];
 	if (TRLEN(s) < 0) {        // this case first as it's the most frequent
@@ -1117,6 +1404,66 @@ static void cgroup(SEXP * x, int *o, int n)
     ustr_n = 0;
 }
 
+static void cgroup(SEXP * x, int *o, int n)
+// As icount :
+//   Places the ordering into o directly, overwriting whatever was there
+//   Doesn't change x
+//   Pushes group sizes onto stack
+
+// Only run when sortStr == FALSE. Basically a counting sort, in first
+// appearance order, directly.  Since it doesn't sort the strings, the
+// name is cgroup.  there is no _pre for this.  ustr created and
+// cleared each time.
+{
+    if (ustr_n != 0)
+	Error
+	    ("Internal error. ustr isn't empty when starting cgroup: ustr_n=%d, ustr_alloc=%d",
+	     ustr_n, ustr_alloc);
+    if (strtl) {
+	cgroup_tl(x, o, n);
+	return;
+    }
+    for (int i = 0; i < n; i++) {
+	SEXP s = x[i];
+	int *v = stab_slot(s);
+	if (*v < 0) {     // this case first as it's the most frequent
+	    (*v)--;       // negative counts
+	    continue;
+	}
+	if (ustr_alloc <= ustr_n) {
+	    // 10000 = 78k of 8byte pointers. Small initial guess,
+	    // negligible time to alloc.
+	    ustr_alloc = (ustr_alloc == 0) ? 10000 : ustr_alloc*2;
+	    if (ustr_alloc > n)
+		ustr_alloc = n;
+	    ustr = realloc(ustr, ustr_alloc * sizeof(SEXP));
+	    if (ustr == NULL)
+		Error("Unable to realloc %d * %d bytes in cgroup", ustr_alloc,
+		      sizeof(SEXP));
+	}
+	*v = -1;
+	ustr[ustr_n++] = s;
+    }
+    // TO DO: the same string in different encodings will be
+    // considered different here. Sweep through ustr and merge counts
+    // where equal (sort needed therefore, unfortunately?, only if
+    // there are any marked encodings present)
+    int cumsum = 0;
+    for (int i = 0; i < ustr_n; i++) {      // 0.000
+	int *v = stab_slot(ustr[i]);
+	push(-*v);
+	*v = (cumsum += -*v);
+    }
+    int *target = (o[0] != -1) ? newo : o;
+    for (int i = n - 1; i >= 0; i--) {
+	target[--*stab_find(x[i])] = i + 1;      // random access to o
+    }
+    // The cummulate meant counts are left non zero, so empty the
+    // table for next time.
+    stab_clear();
+    ustr_n = 0;
+}
+
 static int *csort_otmp = NULL, csort_otmp_alloc = 0;
 static void alloc_csort_otmp(int n)
 {
@@ -1142,8 +1489,21 @@ static void csort(SEXP * x, int *o, int n)
     /* can't use otmp, since iradix might be called here and that uses
        otmp (and xtmp).  alloc_csort_otmp(n) is called from do_radixsort for
        either n=nrow if 1st arg, or n=maxgrpn if onwards args */
-    for (int i = 0; i < n; i++)
-	csort_otmp[i] = (x[i] == NA_STRING) ? NA_INTEGER : -TRLEN(x[i]);
+    int *otmp = csort_otmp, na = NA_INTEGER;
+    SEXP nastr = NA_STRING;
+    if (strtl)
+	for (int i = 0; i < n; i++)
+	    otmp[i] = (x[i] == nastr) ? na : -TRLEN(x[i]);
+    else {
+	// the table is not changed here, so can be read in parallel
+	int nthreads = radix_nthreads(n);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(x, otmp, n, na, nastr) if(nthreads > 1)
+#endif
+	for (int i = 0; i < n; i++)
+	    otmp[i] = (x[i] == nastr) ? na : -stab_get(x[i]);
+    }
     if (nalast == 0 && n == 2) {
         // special case for nalast == 0. n == 1 is handled inside
         // do_radixsort. at least 1 will be NA here else use o from caller
@@ -1192,22 +1552,25 @@ static void csort_pre(SEXP * x, int n)
 {
     SEXP s;
     int old_un, new_un;
-    // savetl_init() is called once at the start of do_radixsort
     old_un = ustr_n;
     for (int i = 0; i < n; i++) {
 	s = x[i];
+	int *v = NULL;
 	// this case first as it's the most frequent. Already in ustr,
 	// this negative is its ordering.
-	if (TRLEN(s) < 0)
-	    continue;
-	// Save any of R's own usage of tl (assumed positive, so we
-	// can both count and save in one scan), to restore
-	// afterwards. From R 2.14.0, tl is initialized to 0, prior to
-	// that it was random so this step saved too much.
-	if (TRLEN(s) > 0) {
-	    savetl(s);
-	    SET_TRLEN(s, 0);
+	if (strtl) {
+	    if (TRLEN(s) < 0)
+		continue;
+	    // Save any of R's own usage of tl (assumed positive, so we
+	    // can both count and save in one scan), to restore
+	    // afterwards.
+	    if (TRLEN(s) > 0) {
+		savetl(s);
+		SET_TRLEN(s, 0);
+	    }
 	}
+	else if (*(v = stab_slot(s)) < 0)
+	    continue;
 	if (ustr_alloc <= ustr_n) {
 	    // 10000 = 78k of 8byte pointers. Small initial guess,
 	    // negligible time to alloc.
@@ -1219,7 +1582,11 @@ static void csort_pre(SEXP * x, int n)
 		Error("Failed to realloc ustr. Requested %d * %d bytes",
 		      ustr_alloc, sizeof(SEXP));
 	}
-	SET_TRLEN(s, -1);  // this -1 will become its ordering later below
+	// this -1 will become its ordering later below
+	if (strtl)
+	    SET_TRLEN(s, -1);
+	else
+	    *v = -1;
 	ustr[ustr_n++] = s;
 	// length on CHARSXP is the nchar of char * (excluding \0),
 	// and treats marked encodings as if ascii.
@@ -1252,11 +1619,15 @@ static void csort_pre(SEXP * x, int n)
             Error("Failed to alloc cradix_tmp");
         cradix_xtmp_alloc = ustr_n;
     }
-    // sorts ustr in-place by reference save ordering in the
-    // CHARSXP. negative so as to distinguish with R's own usage.
+    // sorts ustr in-place by reference and saves the ordering in the
+    // CHARSXP or the table, negative as for cgroup's counts.
     cradix_r(ustr, ustr_n, 0);
-    for (int i = 0; i < ustr_n; i++)
-	SET_TRLEN(ustr[i], -i - 1);
+    if (strtl)
+	for (int i = 0; i < ustr_n; i++)
+	    SET_TRLEN(ustr[i], -i - 1);
+    else
+	for (int i = 0; i < ustr_n; i++)
+	    *stab_slot(ustr[i]) = -i - 1;
 }
 
 // functions to test vectors for sortedness: isorted, dsorted and csorted
@@ -1568,9 +1939,9 @@ attribute_hidden SEXP do_radixsort(SEXP call, SEXP op, SEXP args, SEXP rho)
     retGrp = asLogical(CAR(args));
     args = CDR(args);
 
-    /* If FALSE, get order of strings in appearance order. Essentially
-       abuses the CHARSXP table to group strings without hashing
-       them. Only makes sense when retGrp=TRUE.
+    /* If FALSE, get order of strings in appearance order, grouping
+       them by their CHARSXP pointers. Only makes sense when
+       retGrp=TRUE.
     */
     sortStr = asLogical(CAR(args));
     args = CDR(args);
@@ -1631,6 +2002,8 @@ attribute_hidden SEXP do_radixsort(SEXP call, SEXP op, SEXP args, SEXP rho)
         checkEncodings(x);
     }
     
+    stab_free();
+    strtl = radix_nthreads(n) == 1;
     savetl_init();   // from now on use Error not error.
 
     switch (TYPEOF(x)) {
@@ -1879,11 +2252,13 @@ attribute_hidden SEXP do_radixsort(SEXP call, SEXP op, SEXP args, SEXP rho)
     if (!sortStr && ustr_n != 0)
         Error("Internal error: at the end of do_radixsort sortStr == FALSE but ustr_n !=0 [%d]",
               ustr_n);
-    for(int i = 0; i < ustr_n; i++)
-        SET_TRLEN(ustr[i], 0);
+    if (strtl)
+	for(int i = 0; i < ustr_n; i++)
+	    SET_TRLEN(ustr[i], 0);
     maxlen = 1;  // reset global. Minimum needed to count "" and NA
     ustr_n = 0;
     savetl_end();
+    stab_free();
     free(ustr);
     ustr = NULL;
     ustr_alloc = 0;
@@ -1938,6 +2313,13 @@ attribute_hidden SEXP do_radixsort(SEXP call, SEXP op, SEXP args, SEXP rho)
     free(cradix_xtmp);         cradix_xtmp=NULL;   cradix_xtmp_alloc=0;
     // TO DO: use xtmp already got
 
+    /* an ordering is a permutation, once NA positions are dropped */
+    if (!retGrp && (nalast != 0 || dropZeros)) {
+	PROTECT(ans);
+	ans = R_wrap_unique(ans, UNKNOWN_SORTEDNESS, TRUE);
+	UNPROTECT(1);
+    }
+
     UNPROTECT(1);
     return ans;
 }
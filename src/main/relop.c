@@ -28,6 +28,7 @@
 #include <Rmath.h>
 #include <errno.h>
 #include <R_ext/Itermacros.h>
+#include "bitset.h"
 
 /* interval at which to check interrupts, a guess */
 #define NINTERRUPT 10000000
@@ -325,6 +326,78 @@ attribute_hidden SEXP do_relop_dflt(SEXP call, SEXP op, SEXP x, SEXP y)
     }                                                                   \
 } while(0)
 
+/* Bit-packed results (see bitset.h): the results for 64 elements are
+   collected into one word at a time.  Only used if no operand is
+   recycled, or one is of length one. */
+#define BR_HELPER(OP, type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2) do { \
+	const type1 *px1 = ACCESSOR1(s1);				\
+	const type2 *px2 = ACCESSOR2(s2);				\
+	R_xlen_t d1 = n1 == 1 ? 0 : 1, d2 = n2 == 1 ? 0 : 1;		\
+	for (R_xlen_t w = 0; w < nw; w++) {				\
+	    R_xlen_t i0 = w * 64, nk = n - i0 < 64 ? n - i0 : 64;	\
+	    uint64_t v = 0, m = 0;					\
+	    for (int k = 0; k < nk; k++) {				\
+		type1 x1 = px1[(i0 + k) * d1];				\
+		type2 x2 = px2[(i0 + k) * d2];				\
+		uint64_t na = ISNA1(x1) || ISNA2(x2);			\
+		m |= na << k;						\
+		v |= (uint64_t) (!na && (x1 OP x2)) << k;		\
+	    }								\
+	    pb[w] = v;							\
+	    pm[w] = m;							\
+	    anyna |= m;							\
+	}								\
+    } while (0)
+
+#define BITSET_RELOP(type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2) do { \
+    switch (code) {                                                     \
+    case EQOP:                                                          \
+	BR_HELPER(==, type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2); \
+        break;                                                          \
+    case NEOP:                                                          \
+	BR_HELPER(!=, type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2); \
+        break;                                                          \
+    case LTOP:                                                          \
+	BR_HELPER(<, type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2); \
+        break;                                                          \
+    case GTOP:                                                          \
+	BR_HELPER(>, type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2); \
+        break;                                                          \
+    case LEOP:                                                          \
+	BR_HELPER(<=, type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2); \
+        break;                                                          \
+    case GEOP:                                                          \
+	BR_HELPER(>=, type1, ACCESSOR1, ISNA1, type2, ACCESSOR2, ISNA2); \
+        break;                                                          \
+    }                                                                   \
+} while(0)
+
+static SEXP bitset_relop(RELOP_TYPE code, SEXP s1, SEXP s2,
+			 R_xlen_t n1, R_xlen_t n2, R_xlen_t n)
+{
+    R_xlen_t nw = R_BITSET_WORDS(n);
+    uint64_t anyna = 0;
+    SEXP bits = PROTECT(R_BITSET_ALLOC(n));
+    SEXP nas = PROTECT(R_BITSET_ALLOC(n));
+    uint64_t *pb = R_BITSET_PTR(bits), *pm = R_BITSET_PTR(nas);
+
+    if (isInteger(s1) || isLogical(s1)) {
+        if (isInteger(s2) || isLogical(s2)) {
+            BITSET_RELOP(int, INTEGER, ISNA_INT, int, INTEGER, ISNA_INT);
+        } else {
+            BITSET_RELOP(int, INTEGER, ISNA_INT, double, REAL, ISNAN);
+        }
+    } else if (isInteger(s2) || isLogical(s2)) {
+        BITSET_RELOP(double, REAL, ISNAN, int, INTEGER, ISNA_INT);
+    } else {
+        BITSET_RELOP(double, REAL, ISNAN, double, REAL, ISNAN);
+    }
+
+    SEXP ans = R_bitset_logical(n, bits, anyna ? nas : R_NilValue);
+    UNPROTECT(2); /* bits, nas */
+    return ans;
+}
+
 static SEXP numeric_relop(RELOP_TYPE code, SEXP s1, SEXP s2)
 {
     R_xlen_t i, i1, i2, n, n1, n2;
@@ -335,6 +408,12 @@ static SEXP numeric_relop(RELOP_TYPE code, SEXP s1, SEXP s2)
     n = (n1 > n2) ? n1 : n2;
     PROTECT(s1);
     PROTECT(s2);
+    if (R_BitsetLogical && n >= R_BITSET_MIN_N &&
+	(n1 == n2 || n1 == 1 || n2 == 1)) {
+	ans = bitset_relop(code, s1, s2, n1, n2, n);
+	UNPROTECT(2);
+	return ans;
+    }
     ans = allocVector(LGLSXP, n);
 
     if (isInteger(s1) || isLogical(s1)) {
@@ -415,6 +494,7 @@ static SEXP string_relop(RELOP_TYPE code, SEXP s1, SEXP s2)
     R_xlen_t i, n, n1, n2, res, i1, i2;
     SEXP ans, c1, c2;
     const void *vmax = vmaxget(); // for Scollate
+    Rboolean keys = code != EQOP && code != NEOP && R_useCollationKeys();
 
     n1 = XLENGTH(s1);
     n2 = XLENGTH(s2);
@@ -458,7 +538,7 @@ static SEXP string_relop(RELOP_TYPE code, SEXP s1, SEXP s2)
 		pa[i] = 0;
 	    else {
 		errno = 0;
-		res = Scollate(c1, c2);
+		res = keys ? ScollateKeys(c1, c2) : Scollate(c1, c2);
 		if(errno)
 		    pa[i] = NA_LOGICAL;
 		else
@@ -477,7 +557,7 @@ static SEXP string_relop(RELOP_TYPE code, SEXP s1, SEXP s2)
 		pa[i] = 0;
 	    else {
 		errno = 0;
-		res = Scollate(c1, c2);
+		res = keys ? ScollateKeys(c1, c2) : Scollate(c1, c2);
 		if(errno)
 		    pa[i] = NA_LOGICAL;
 		else
@@ -496,7 +576,7 @@ static SEXP string_relop(RELOP_TYPE code, SEXP s1, SEXP s2)
 		pa[i] = 1;
 	    else {
 		errno = 0;
-		res = Scollate(c1, c2);
+		res = keys ? ScollateKeys(c1, c2) : Scollate(c1, c2);
 		if(errno)
 		    pa[i] = NA_LOGICAL;
 		else
@@ -515,7 +595,7 @@ static SEXP string_relop(RELOP_TYPE code, SEXP s1, SEXP s2)
 		pa[i] = 1;
 	    else {
 		errno = 0;
-		res = Scollate(c1, c2);
+		res = keys ? ScollateKeys(c1, c2) : Scollate(c1, c2);
 		if(errno)
 		    pa[i] = NA_LOGICAL;
 		else
@@ -282,6 +282,11 @@ static SEXP rep3(SEXP s, R_xlen_t ns, R_xlen_t na)
     R_xlen_t i, j;
     SEXP a;
 
+    /* long results are created as repeated vectors, materialized
+       only when a data pointer is needed */
+    if ((a = R_rep_vector(s, na, 1)) != NULL)
+	return a;
+
     PROTECT(a = allocVector(TYPEOF(s), na));
 
     switch (TYPEOF(s)) {
@@ -485,6 +490,8 @@ static SEXP rep4(SEXP x, SEXP times, R_xlen_t len, R_xlen_t each, R_xlen_t nt)
 
     // faster code for common special case
     if (each == 1 && nt == 1) return rep3(x, lx, len);
+    if (nt == 1 && (a = R_rep_vector(x, len, each)) != NULL)
+	return a;
 
     PROTECT(a = allocVector(TYPEOF(x), len));
 
@@ -79,7 +79,38 @@ static int scmp(SEXP x, SEXP y, Rboolean nalast)
     if (x == NA_STRING) return nalast ? 1 : -1;
     if (y == NA_STRING) return nalast ? -1 : 1;
     if (x == y) return 0;  /* same string in cache */
-    return Scollate(x, y);
+    return R_useCollationKeys() ? ScollateKeys(x, y) : Scollate(x, y);
+}
+
+/* The collation keys of the non-NA elements of sx[0:(n-1)], or
+   R_NilValue if options(collation.keys) is false or some element has
+   none.  Sorting on the keys avoids collating each string O(log n)
+   times. */
+static SEXP collationKeys(const SEXP *sx, R_xlen_t n)
+{
+    if (!R_useCollationKeys()) return R_NilValue;
+    SEXP keys = PROTECT(allocVector(VECSXP, n));
+    for (R_xlen_t i = 0; i < n; i++)
+	if (sx[i] != NA_STRING) {
+	    SEXP k = R_CollationKey(sx[i]);
+	    if (k == R_NilValue) {
+		UNPROTECT(1);
+		return R_NilValue;
+	    }
+	    SET_VECTOR_ELT(keys, i, k);
+	}
+    UNPROTECT(1);
+    return keys;
+}
+
+/* scmp() with nalast = TRUE on strings with keys kx and ky */
+static R_INLINE int kscmp(SEXP x, SEXP y, SEXP kx, SEXP ky)
+{
+    if (x == NA_STRING && y == NA_STRING) return 0;
+    if (x == NA_STRING) return 1;
+    if (y == NA_STRING) return -1;
+    if (x == y) return 0;
+    return R_CollationKeyCmp(kx, ky);
 }
 
 #define R_INT_MIN 1 + INT_MIN //INT_MIN is NA_INTEGER
@@ -606,12 +637,46 @@ static void R_csort2(Rcomplex *x, R_xlen_t n, Rboolean decreasing)
 	}
 }
 
+static void ssort2keys(SEXP *x, SEXP keys, R_xlen_t n, Rboolean decreasing)
+{
+    SEXP v, kv;
+    R_xlen_t i, j, h, t;
+    const void *vmax = vmaxget();
+    /* the keys are permuted along with x, and kept alive by 'keys' */
+    SEXP *k = (SEXP *) R_alloc(n, sizeof(SEXP));
+    for (i = 0; i < n; i++) k[i] = VECTOR_ELT(keys, i);
+
+    for (t = 0; incs[t] > n; t++);
+    for (h = incs[t]; t < NI; h = incs[++t])
+	for (i = h; i < n; i++) {
+	    v = x[i];
+	    kv = k[i];
+	    j = i;
+	    if(decreasing)
+		while (j >= h && kscmp(x[j - h], v, k[j - h], kv) < 0)
+		{ x[j] = x[j - h]; k[j] = k[j - h]; j -= h; }
+	    else
+		while (j >= h && kscmp(x[j - h], v, k[j - h], kv) > 0)
+		{ x[j] = x[j - h]; k[j] = k[j - h]; j -= h; }
+	    x[j] = v;
+	    k[j] = kv;
+	}
+    vmaxset(vmax);
+}
+
 static void ssort2(SEXP *x, R_xlen_t n, Rboolean decreasing)
 {
     SEXP v;
     R_xlen_t i, j, h, t;
 
     if (n < 2) error("'n >= 2' is required");
+    SEXP keys = PROTECT(collationKeys(x, n));
+    if (keys != R_NilValue) {
+	ssort2keys(x, keys, n, decreasing);
+	UNPROTECT(1);
+	return;
+    }
+    UNPROTECT(1);
     for (t = 0; incs[t] > n; t++);
     for (h = incs[t]; t < NI; h = incs[++t])
 	for (i = h; i < n; i++) {
@@ -1259,7 +1324,19 @@ orderVector1(int *indx, int n, SEXP key, Rboolean nalast, Rboolean decreasing,
 	    }
 	    break;
 	case STRSXP:
-	    if (decreasing)
+	{
+	    SEXP keys = PROTECT(collationKeys(sx, n));
+	    if (keys != R_NilValue) {
+		const SEXP *kx = (const SEXP *) DATAPTR_RO(keys);
+		if (decreasing)
+#define less(a, b) (c = R_CollationKeyCmp(kx[a], kx[b]), c < 0 || (c == 0 && a > b))
+		    sort2_with_index
+#undef less
+		else
+#define less(a, b) (c = R_CollationKeyCmp(kx[a], kx[b]), c > 0 || (c == 0 && a > b))
+		    sort2_with_index
+#undef less
+	    } else if (decreasing)
 #define less(a, b) (c = Scollate(sx[a], sx[b]), c < 0 || (c == 0 && a > b))
 		sort2_with_index
 #undef less
@@ -1267,7 +1344,9 @@ orderVector1(int *indx, int n, SEXP key, Rboolean nalast, Rboolean decreasing,
 #define less(a, b) (c = Scollate(sx[a], sx[b]), c > 0 || (c == 0 && a > b))
 		sort2_with_index
 #undef less
+	    UNPROTECT(1);
 	    break;
+	}
 	default:  /* only reached from do_rank */
 #define less(a, b) greater(a, b, key, nalast^decreasing, decreasing, rho)
 	    sort2_with_index
@@ -1396,7 +1475,19 @@ orderVector1l(R_xlen_t *indx, R_xlen_t n, SEXP key, Rboolean nalast,
 	    }
 	    break;
 	case STRSXP:
-	    if (decreasing)
+	{
+	    SEXP keys = PROTECT(collationKeys(sx, n));
+	    if (keys != R_NilValue) {
+		const SEXP *kx = (const SEXP *) DATAPTR_RO(keys);
+		if (decreasing)
+#define less(a, b) (c=R_CollationKeyCmp(kx[a], kx[b]), c < 0 || (c == 0 && a > b))
+		    sort2_with_index
+#undef less
+		else
+#define less(a, b) (c=R_CollationKeyCmp(kx[a], kx[b]), c > 0 || (c == 0 && a > b))
+		    sort2_with_index
+#undef less
+	    } else if (decreasing)
 #define less(a, b) (c=Scollate(sx[a], sx[b]), c < 0 || (c == 0 && a > b))
 		sort2_with_index
 #undef less
@@ -1404,7 +1495,9 @@ orderVector1l(R_xlen_t *indx, R_xlen_t n, SEXP key, Rboolean nalast,
 #define less(a, b) (c=Scollate(sx[a], sx[b]), c > 0 || (c == 0 && a > b))
 		sort2_with_index
 #undef less
+	    UNPROTECT(1);
 	    break;
+	}
 	default:  /* only reached from do_rank */
 #define less(a, b) greater(a, b, key, nalast^decreasing, decreasing, rho)
 	    sort2_with_index
@@ -124,10 +124,13 @@ static R_INLINE SEXP getNames(SEXP x)
 
 /* EnlargeVector() takes a vector "x" and changes its length to "newlen".
    This allows to assign values "past the end" of the vector or list.
-   Overcommit by a small percentage to allow more efficient vector growth.
+   Overcommit by a small percentage to allow more efficient vector growth,
+   and geometrically for vectors enlarged before.
 */
 static SEXP EnlargeNames(SEXP, R_xlen_t, R_xlen_t);
 
+#define GROWTH_FACTOR 1.5
+
 static SEXP EnlargeVector(SEXP x, R_xlen_t newlen)
 {
     R_xlen_t len, newtruelen;
@@ -178,6 +181,13 @@ static SEXP EnlargeVector(SEXP x, R_xlen_t newlen)
 
     if (newlen > len) {
 	double expanded_nlen = newlen * expand;
+	/* A vector with the growable bit has been enlarged before, so is
+	   likely to be grown in a loop as by x[length(x) + 1] <- v: it is
+	   given room for half its length again, so that appending copies
+	   elements about 3 rather than 20 times overall.  The extra space
+	   goes with the vector, and is not kept by duplicate(). */
+	if (GROWABLE_BIT_SET(x) && expanded_nlen < newlen * GROWTH_FACTOR)
+	    expanded_nlen = newlen * GROWTH_FACTOR;
 	if (expanded_nlen <= R_XLEN_T_MAX)
 	    newtruelen = (R_xlen_t) expanded_nlen;
 	else
@@ -922,6 +932,87 @@ SEXP int_arraySubscript(int dim, SEXP s, SEXP dims, SEXP x, SEXP call);
 	    }						\
     } while (0)
 
+/* x[sr, sc] <- y for x and y of the same atomic type, without NA
+   subscripts, when y has a data pointer and either fills the block or
+   is a single value.  This is done a column at a time, with memcpy
+   for contiguous rows.  When the columns are increasing, so that no
+   column of x is assigned twice, the columns can be handled by
+   R_num_math_threads threads. */
+
+#define SCATTER_THREADS_MIN_N 100000
+
+#define SCATTER_COLUMN(TYPE) do {					\
+	TYPE *px = (TYPE *) dst;					\
+	const TYPE *py = (const TYPE *) src;				\
+	if (ny == 1)							\
+	    for (R_xlen_t i = 0; i < nrs; i++)				\
+		px[psr[i] - 1] = py[0];					\
+	else								\
+	    for (R_xlen_t i = 0; i < nrs; i++)				\
+		px[psr[i] - 1] = py[i];					\
+    } while (0)
+
+static void scatterColumn(SEXPTYPE type, void *dst, const void *src,
+			  const int *psr, R_xlen_t nrs, R_xlen_t ny)
+{
+    switch(type) {
+    case LGLSXP:
+    case INTSXP:  SCATTER_COLUMN(int); break;
+    case REALSXP: SCATTER_COLUMN(double); break;
+    case CPLXSXP: SCATTER_COLUMN(Rcomplex); break;
+    case RAWSXP:  SCATTER_COLUMN(Rbyte); break;
+    default: break;
+    }
+}
+
+static Rboolean scatterColumns(SEXP x, SEXP y, const int *psr, int nrs,
+			       const int *psc, int ncs, int nr)
+{
+    SEXPTYPE type = TYPEOF(x);
+    size_t size;
+    switch(type) {
+    case LGLSXP:
+    case INTSXP: size = sizeof(int); break;
+    case REALSXP: size = sizeof(double); break;
+    case CPLXSXP: size = sizeof(Rcomplex); break;
+    case RAWSXP: size = sizeof(Rbyte); break;
+    default: return FALSE;
+    }
+    R_xlen_t n = (R_xlen_t) nrs * ncs, ny = XLENGTH(y);
+    const char *py = (const char *) DATAPTR_OR_NULL(y);
+    if (py == NULL || (ny != n && ny != 1) ||
+	(TYPEOF(y) != type && !(type == INTSXP && TYPEOF(y) == LGLSXP)))
+	return FALSE;
+    char *px = (char *) DATAPTR(x);
+
+    Rboolean contig = TRUE, increasing = TRUE;
+    for (int i = 1; i < nrs && contig; i++)
+	contig = psr[i] == psr[0] + i;
+    for (int j = 1; j < ncs && increasing; j++)
+	increasing = psc[j] > psc[j - 1];
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    if (n >= SCATTER_THREADS_MIN_N && ncs > 1 && increasing &&
+	R_num_math_threads > 1)
+	nthreads = R_num_math_threads;
+#endif
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(type, size, px, py, psr, nrs, psc, ncs, nr, \
+			       ny, contig)
+#endif
+    for (int j = 0; j < ncs; j++) {
+	char *dst = px + (psc[j] - 1) * (R_xlen_t) nr * size;
+	const char *src = ny == 1 ? py : py + j * (R_xlen_t) nrs * size;
+	if (contig && ny != 1)
+	    memcpy(dst + (psr[0] - 1) * size, src, nrs * size);
+	else
+	    scatterColumn(type, dst, src, psr, nrs, ny);
+    }
+    return TRUE;
+}
+
 static SEXP MatrixAssign(SEXP call, SEXP rho, SEXP x, SEXP s, SEXP y)
 {
     int which;
@@ -990,6 +1081,11 @@ static SEXP MatrixAssign(SEXP call, SEXP rho, SEXP x, SEXP s, SEXP y)
     /* existing objects any changes we make now are permanent. */
     /* Beware! */
 
+    if (!anyIdxNA && scatterColumns(x, y, psr, nrs, psc, ncs, nr)) {
+	UNPROTECT(2);
+	return x;
+    }
+
     switch (which) {
 	/* because we have called SubassignTypeFix the commented
 	   values cannot occur (and would be unsafe) */
@@ -38,6 +38,7 @@
 #include <Defn.h>
 
 #include <R_ext/Itermacros.h>
+#include "bitset.h"
 
 /* interval at which to check interrupts, a guess (~subsecond on current hw) */
 #define NINTERRUPT 10000000
@@ -274,16 +275,17 @@ get1index(SEXP s, SEXP names, R_xlen_t len, int pok, int pos, SEXP call)
 	/* "" matches nothing: see names.Rd */
 	if(!CHAR(STRING_ELT(s, pos))[0]) break;
 
-	/* Try for exact match */
+	/* Try for exact match, by the name index if it can be used */
 	vmax = vmaxget();
 	ss = translateChar(STRING_ELT(s, pos));
-	for (R_xlen_t i = 0; i < xlength(names); i++)
-	    if (STRING_ELT(names, i) != NA_STRING) {
-		if (streql(translateChar(STRING_ELT(names, i)), ss)) {
-		    indx = i;
-		    break;
+	if (!R_lookupNameIndex(names, STRING_ELT(s, pos), &indx))
+	    for (R_xlen_t i = 0; i < xlength(names); i++)
+		if (STRING_ELT(names, i) != NA_STRING) {
+		    if (streql(translateChar(STRING_ELT(names, i)), ss)) {
+			indx = i;
+			break;
+		    }
 		}
-	    }
 	/* Try for partial match */
 	if (pok && indx < 0) {
 	    size_t len = strlen(ss);
@@ -322,14 +324,15 @@ get1index(SEXP s, SEXP names, R_xlen_t len, int pok, int pos, SEXP call)
 	    ECALL_MissingSubs(call);
 	}
 	vmax = vmaxget();
-	for (R_xlen_t i = 0; i < xlength(names); i++)
-	    if (STRING_ELT(names, i) != NA_STRING &&
-		streql(translateChar(STRING_ELT(names, i)),
-		       CHAR(PRINTNAME(s)))) {
-		indx = i;
-		vmaxset(vmax);
-		break;
-	    }
+	if (!R_lookupNameIndex(names, PRINTNAME(s), &indx))
+	    for (R_xlen_t i = 0; i < xlength(names); i++)
+		if (STRING_ELT(names, i) != NA_STRING &&
+		    streql(translateChar(STRING_ELT(names, i)),
+			   CHAR(PRINTNAME(s)))) {
+		    indx = i;
+		    vmaxset(vmax);
+		    break;
+		}
 	break;
     default:
 	ECALL3(call, _("invalid subscript type '%s'"), R_typeToChar(s));
@@ -587,6 +590,43 @@ static SEXP nullSubscript(R_xlen_t n)
 }
 
 
+/* Indices of the TRUE and NA elements of a bit-packed logical
+   subscript, see bitset.h */
+static SEXP bitsetSubscript(const uint64_t *bits, const uint64_t *nas,
+			    R_xlen_t ns)
+{
+    R_xlen_t nw = R_BITSET_WORDS(ns), count = R_bitset_count(bits, ns), j = 0;
+    if (nas != NULL)
+	count += R_bitset_count(nas, ns);
+    SEXP indx;
+#ifdef LONG_VECTOR_SUPPORT
+    if (ns > R_SHORT_LEN_MAX) {
+	PROTECT(indx = allocVector(REALSXP, count));
+	double *pindx = REAL(indx);
+	for (R_xlen_t w = 0; w < nw; w++) {
+	    uint64_t m = nas ? nas[w] : 0;
+	    for (uint64_t b = bits[w] | m; b; b &= b - 1) {
+		int k = R_bitset_ctz(b);
+		pindx[j++] = ((m >> k) & 1) ? NA_REAL : (double)(w * 64 + k + 1);
+	    }
+	}
+	UNPROTECT(1);
+	return indx;
+    }
+#endif
+    PROTECT(indx = allocVector(INTSXP, count));
+    int *pindx = INTEGER(indx);
+    for (R_xlen_t w = 0; w < nw; w++) {
+	uint64_t m = nas ? nas[w] : 0;
+	for (uint64_t b = bits[w] | m; b; b &= b - 1) {
+	    int k = R_bitset_ctz(b);
+	    pindx[j++] = ((m >> k) & 1) ? NA_INTEGER : (int)(w * 64 + k + 1);
+	}
+    }
+    UNPROTECT(1);
+    return indx;
+}
+
 static SEXP
 logicalSubscript(SEXP s, R_xlen_t ns, R_xlen_t nx, R_xlen_t *stretch, SEXP call)
 {
@@ -600,6 +640,9 @@ logicalSubscript(SEXP s, R_xlen_t ns, R_xlen_t nx, R_xlen_t *stretch, SEXP call)
     nmax = (ns > nx) ? ns : nx;
     *stretch = (ns > nx) ? ns : 0;
     if (ns == 0) return(allocVector(INTSXP, 0));
+    const uint64_t *bits, *nas;
+    if (ns == nmax && R_bitset_logical_words(s, &bits, &nas))
+	return bitsetSubscript(bits, nas, ns);
     const int *ps = LOGICAL_RO(s);    /* Calling LOCICAL_RO here may force a
 					 large allocation, but no larger than
 					 the one made by R_alloc below. This
@@ -757,6 +800,20 @@ integerSubscript(SEXP s, R_xlen_t ns, R_xlen_t nx, R_xlen_t *stretch,
     *stretch = 0;
     neg = FALSE;
     max = 0;
+    R_xlen_t cn;
+    double c1, cinc;
+    if (ns > 0 && R_compact_seq_info(s, &cn, &c1, &cinc) &&
+	(cinc > 0 ? c1 : c1 + (ns - 1) * cinc) >= 1) {
+	/* a positive compact sequence, used as is */
+	max = (int) (cinc > 0 ? c1 + (ns - 1) * cinc : c1);
+	if (max > nx) {
+	    if(canstretch) *stretch = max;
+	    else {
+		ECALL_OutOfBounds(x, -1, max, call);
+	    }
+	}
+	return s;
+    }
     const int *ps = INTEGER_RO(s);
     for (i = 0; i < ns; i++) {
 	ii = ps[i];
@@ -792,6 +849,24 @@ realSubscript(SEXP s, R_xlen_t ns, R_xlen_t nx, R_xlen_t *stretch,
     int canstretch = *stretch > 0;
     *stretch = 0;
     double min = 0, max = 0;
+    R_xlen_t cn;
+    double c1, cinc;
+    if (ns > 0 && R_compact_seq_info(s, &cn, &c1, &cinc) && c1 == floor(c1)) {
+	min = cinc > 0 ? c1 : c1 + (ns - 1) * cinc;
+	max = cinc > 0 ? c1 + (ns - 1) * cinc : c1;
+	if (min >= 1 && max <= INT_MAX) {
+	    /* a positive compact sequence, as an integer one */
+	    if (max >= nx+1.) {
+		if(canstretch) *stretch = (R_xlen_t) max;
+		else {
+		    ECALL_OutOfBounds(x, -1, (R_xlen_t) max, call);
+		}
+	    }
+	    return R_compact_intrange((R_xlen_t) c1,
+				      (R_xlen_t) (c1 + (ns - 1) * cinc));
+	}
+	min = max = 0;
+    }
     const double *ps = REAL_RO(s);
     Rboolean isna = FALSE;
     for (R_xlen_t i = 0; i < ns; i++) {
@@ -912,7 +987,12 @@ stringSubscript(SEXP s, R_xlen_t ns, R_xlen_t nx, SEXP names,
      * nonmatch will have given an error.)
      */
 
-    if(usehashing) {
+    R_xlen_t sub1;
+    if (ns == 1 && R_lookupNameIndex(names, STRING_ELT(s, 0), &sub1)) {
+	/* one name, by the name index */
+	PROTECT(indx = ScalarInteger((int) (sub1 + 1)));
+	nprotect++;
+    } else if(usehashing) {
 	/* must be internal, so names contains a character vector */
 	/* NB: this does not behave in the same way with respect to ""
 	   and NA names: they will match */
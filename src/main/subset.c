@@ -40,6 +40,7 @@
 
 #include <Defn.h>
 #include <Internal.h>
+#include "bitset.h"
 
 /* JMC convinced MM that this was not a good idea: */
 #undef _S4_subsettable
@@ -112,6 +113,82 @@ NORET static void errorcallMissingSubs(SEXP x, SEXP call)
 }
 
 
+/* Subsets of at least this length taken with arithmetic subscripts
+   are views of the vector when options(subset.views) is true, see
+   R_subset_view() in altclasses.c. */
+#define SUBSET_VIEW_MIN_N 65536
+
+/* If the subscripts indx select the elements first, first + stride,
+   ... (0-based, stride >= 1) of a vector of length nx, set first and
+   stride and return TRUE.  Compact sequences are not expanded. */
+static Rboolean arithSubscript(SEXP indx, R_xlen_t nx,
+			       R_xlen_t *first, R_xlen_t *stride)
+{
+    R_xlen_t n = XLENGTH(indx), cn;
+    double c1, cinc, last;
+    if (n == 0)
+	return FALSE;
+    if (R_compact_seq_info(indx, &cn, &c1, &cinc)) {
+	if ((cinc < 0 && n > 1) || c1 < 1 || c1 != floor(c1) ||
+	    c1 + (n - 1) * cinc > nx)
+	    return FALSE;
+	*first = (R_xlen_t) c1 - 1;
+	*stride = 1;
+	return TRUE;
+    }
+    switch(TYPEOF(indx)) {
+    case INTSXP:
+    {
+	const int *pi = INTEGER_RO(indx);
+	R_xlen_t i0 = pi[0], d = n > 1 ? (R_xlen_t) pi[1] - i0 : 1;
+	if (i0 < 1 || d < 1 || i0 + (n - 1) * d > nx ||
+	    pi[n - 1] != i0 + (n - 1) * d)
+	    return FALSE;
+	for (R_xlen_t k = 2; k < n - 1; k++)
+	    if (pi[k] != i0 + k * d) return FALSE;
+	*first = i0 - 1;
+	*stride = d;
+	return TRUE;
+    }
+    case REALSXP:
+    {
+	const double *pi = REAL_RO(indx);
+	double d0 = pi[0], dd = n > 1 ? pi[1] - d0 : 1;
+	if (!(d0 >= 1 && dd >= 1 && d0 == floor(d0) && dd == floor(dd)))
+	    return FALSE;
+	last = d0 + (n - 1) * dd;
+	if (last > nx || pi[n - 1] != last)
+	    return FALSE;
+	for (R_xlen_t k = 2; k < n - 1; k++)
+	    if (pi[k] != d0 + k * dd) return FALSE;
+	*first = (R_xlen_t) d0 - 1;
+	*stride = (R_xlen_t) dd;
+	return TRUE;
+    }
+    default:
+	return FALSE;
+    }
+}
+
+static SEXP subsetView(SEXP x, SEXP indx)
+{
+    R_xlen_t first, stride;
+    switch(TYPEOF(x)) {
+    case LGLSXP:
+    case INTSXP:
+    case REALSXP:
+    case CPLXSXP:
+    case STRSXP:
+	break;
+    default:
+	return NULL;
+    }
+    if (XLENGTH(indx) < SUBSET_VIEW_MIN_N ||
+	!arithSubscript(indx, xlength(x), &first, &stride))
+	return NULL;
+    return R_subset_view(x, first, stride, XLENGTH(indx));
+}
+
 attribute_hidden SEXP ExtractSubset(SEXP x, SEXP indx, SEXP call)
 {
     if (x == R_NilValue)
@@ -125,6 +202,9 @@ attribute_hidden SEXP ExtractSubset(SEXP x, SEXP indx, SEXP call)
 	    return result;
     }
 
+    if (R_SubsetViews && (result = subsetView(x, indx)) != NULL)
+	return result;
+
     R_xlen_t i, ii, n, nx;
     n = XLENGTH(indx);
     nx = xlength(x);
@@ -178,11 +258,185 @@ attribute_hidden SEXP ExtractSubset(SEXP x, SEXP indx, SEXP call)
 }
 
 
+/* Subsetting by a logical mask of the same length as the vector is
+   done without building the index vector logicalSubscript() would
+   produce: one pass over the mask counts the selected elements and a
+   second copies them.  When there are no NAs and the mask is not
+   sparse the copy is branch-free, otherwise blocks of the mask with
+   nothing selected are skipped.  A bit-packed mask (see bitset.h) is
+   gathered a word at a time. */
+
+typedef struct {
+    const int *ps;			/* the mask, or NULL if bit-packed */
+    const uint64_t *bits, *nas;
+    R_xlen_t n, count, nna, last;	/* 'last' is the last selected */
+} mask_info;
+
+static Rboolean getMaskInfo(SEXP s, R_xlen_t n, mask_info *m)
+{
+    if (TYPEOF(s) != LGLSXP || XLENGTH(s) != n || n == 0)
+	return FALSE;
+    m->n = n;
+    m->ps = NULL;
+    if (R_bitset_logical_words(s, &m->bits, &m->nas)) {
+	m->nna = m->nas ? R_bitset_count(m->nas, n) : 0;
+	m->count = R_bitset_count(m->bits, n) + m->nna;
+	return TRUE;
+    }
+    const int *ps = m->ps = (const int *) DATAPTR_OR_NULL(s);
+    if (ps == NULL)
+	return FALSE;
+    R_xlen_t count = 0, nna = 0, last = n - 1;
+    /* int counts over blocks, so the loop can be vectorized */
+    for (R_xlen_t i0 = 0; i0 < n; i0 += 4096) {
+	R_xlen_t i1 = (n - i0 > 4096) ? i0 + 4096 : n;
+	int c = 0, cna = 0;
+	#pragma omp simd reduction(+:c, cna)
+	for (R_xlen_t i = i0; i < i1; i++) {
+	    c += ps[i] != 0;
+	    cna += ps[i] == NA_LOGICAL;
+	}
+	count += c;
+	nna += cna;
+    }
+    while (last >= 0 && ps[last] == 0) last--;
+    m->count = count;
+    m->nna = nna;
+    m->last = last;
+    return TRUE;
+}
+
+/* As for EXTRACT_SUBSET_LOOP, the code assigns element ii of x to
+   element i of the result. */
+#define MASK_SUBSET_LOOP(STDCODE, NACODE) do {				\
+	R_xlen_t i = 0;							\
+	if (m->ps == NULL) {						\
+	    R_xlen_t nw = R_BITSET_WORDS(m->n);				\
+	    for (R_xlen_t w = 0; w < nw; w++) {				\
+		uint64_t na = m->nas ? m->nas[w] : 0;			\
+		for (uint64_t b = m->bits[w] | na; b; b &= b - 1, i++) { \
+		    int k = R_bitset_ctz(b);				\
+		    R_xlen_t ii = 64 * w + k;				\
+		    if ((na >> k) & 1) NACODE; else STDCODE;		\
+		}							\
+	    }								\
+	}								\
+	else {								\
+	    const int *ps = m->ps;					\
+	    R_xlen_t n = m->last + 1, ii = 0;				\
+	    for (; ii + 8 <= n; ii += 8) {				\
+		int any = 0;						\
+		for (int k = 0; k < 8; k++)				\
+		    any |= ps[ii + k];					\
+		if (any) {						\
+		    R_xlen_t ii0 = ii;					\
+		    for (; ii < ii0 + 8; ii++)				\
+			if (ps[ii]) {					\
+			    if (ps[ii] == NA_LOGICAL) NACODE;		\
+			    else STDCODE;				\
+			    i++;					\
+			}						\
+		    ii = ii0;						\
+		}							\
+	    }								\
+	    for (; ii < n; ii++)					\
+		if (ps[ii]) {						\
+		    if (ps[ii] == NA_LOGICAL) NACODE; else STDCODE;	\
+		    i++;						\
+		}							\
+	}								\
+    } while (0)
+
+/* the dense case: the store at i is harmless while i < count, which
+   holds up to and including the last selected element */
+#define MASK_SUBSET_DENSE(PR, PX) do {					\
+	const int *ps = m->ps;						\
+	for (R_xlen_t ii = 0, i = 0; ii <= m->last; ii++) {		\
+	    PR[i] = PX[ii];						\
+	    i += ps[ii] != 0;						\
+	}								\
+    } while (0)
+
+static SEXP maskSubset(SEXP x, const mask_info *m)
+{
+    int mode = TYPEOF(x);
+    const void *px = NULL;
+    if (mode == STRSXP) {
+	if (ALTREP(x))
+	    return NULL; /* e.g. deferred strings have their own method */
+    }
+    else if ((px = DATAPTR_OR_NULL(x)) == NULL)
+	return NULL;
+    Rboolean dense = m->ps != NULL && m->nna == 0 && m->count > m->n / 8;
+
+    SEXP result;
+    switch(mode) {
+    case LGLSXP:
+    case INTSXP:
+    {
+	result = allocVector(mode, m->count);
+	const int *pxi = px;
+	int *pr = INTEGER0(result);
+	if (dense)
+	    MASK_SUBSET_DENSE(pr, pxi);
+	else
+	    MASK_SUBSET_LOOP(pr[i] = pxi[ii], pr[i] = NA_INTEGER);
+	break;
+    }
+    case REALSXP:
+    {
+	result = allocVector(mode, m->count);
+	const double *pxd = px;
+	double *pr = REAL0(result);
+	if (dense)
+	    MASK_SUBSET_DENSE(pr, pxd);
+	else
+	    MASK_SUBSET_LOOP(pr[i] = pxd[ii], pr[i] = NA_REAL);
+	break;
+    }
+    case CPLXSXP:
+    {
+	Rcomplex NA_CPLX = { .r = NA_REAL, .i = NA_REAL };
+	result = allocVector(mode, m->count);
+	const Rcomplex *pxc = px;
+	Rcomplex *pr = COMPLEX0(result);
+	if (dense)
+	    MASK_SUBSET_DENSE(pr, pxc);
+	else
+	    MASK_SUBSET_LOOP(pr[i] = pxc[ii], pr[i] = NA_CPLX);
+	break;
+    }
+    case RAWSXP:
+    {
+	result = allocVector(mode, m->count);
+	const Rbyte *pxr = px;
+	Rbyte *pr = RAW0(result);
+	if (dense)
+	    MASK_SUBSET_DENSE(pr, pxr);
+	else
+	    MASK_SUBSET_LOOP(pr[i] = pxr[ii], pr[i] = (Rbyte) 0);
+	break;
+    }
+    case STRSXP:
+    {
+	PROTECT(result = allocVector(mode, m->count));
+	const SEXP *pxs = STRING_PTR_RO(x);
+	MASK_SUBSET_LOOP(SET_STRING_ELT(result, i, pxs[ii]),
+			 SET_STRING_ELT(result, i, NA_STRING));
+	UNPROTECT(1);
+	break;
+    }
+    default:
+	return NULL;
+    }
+    return result;
+}
+
 /* This is for all cases with a single index, including 1D arrays and
    matrix indexing of arrays */
 static SEXP VectorSubset(SEXP x, SEXP s, SEXP call)
 {
-    if (s == R_MissingArg) return duplicate(x);
+    if (s == R_MissingArg) return shallow_duplicate(x);
 
     /* Check to see if we have special matrix subscripting. */
     /* If we do, make a real subscript vector and protect it. */
@@ -205,15 +459,30 @@ static SEXP VectorSubset(SEXP x, SEXP s, SEXP call)
 	}
     }
 
-    /* Convert to a vector of integer subscripts */
-    /* in the range 1:length(x). */
-    R_xlen_t stretch = 1;
-    SEXP indx = PROTECT(makeSubscript(x, s, &stretch, call));
+    /* A logical mask as long as x is handled by maskSubset(), unless
+       a srcref has to be subsetted too. */
+    mask_info mask;
+    SEXP result = NULL, indx = R_NilValue;
+    if (getMaskInfo(s, xlength(x), &mask) &&
+	(ATTRIB(x) == R_NilValue ||
+	 getAttrib(x, R_SrcrefSymbol) == R_NilValue))
+	result = maskSubset(x, &mask);
+
+    if (result == NULL) {
+	/* Convert to a vector of integer subscripts */
+	/* in the range 1:length(x). */
+	R_xlen_t stretch = 1;
+	indx = makeSubscript(x, s, &stretch, call);
+    }
+    PROTECT_INDEX ipi;
+    PROTECT_WITH_INDEX(indx, &ipi);
 
     /* Allocate the result. */
 
     int mode = TYPEOF(x);
-    SEXP result = PROTECT(ExtractSubset(x, indx, call));
+    if (result == NULL)
+	result = ExtractSubset(x, indx, call);
+    PROTECT(result);
     if (mode == VECSXP || mode == EXPRSXP)
 	/* we do not duplicate the values when extracting the subset,
 	   so to be conservative mark the result as NAMED = NAMEDMAX */
@@ -230,7 +499,16 @@ static SEXP VectorSubset(SEXP x, SEXP s, SEXP call)
 		)
 	    ) {
 	    PROTECT(attrib);
-	    PROTECT(nattrib = ExtractSubset(attrib, indx, call));
+	    nattrib = (indx == R_NilValue) ? maskSubset(attrib, &mask) : NULL;
+	    if (nattrib == NULL) {
+		if (indx == R_NilValue) {
+		    R_xlen_t stretch = 1;
+		    REPROTECT(indx = makeSubscript(x, s, &stretch, call),
+			      ipi);
+		}
+		nattrib = ExtractSubset(attrib, indx, call);
+	    }
+	    PROTECT(nattrib);
 	    setAttrib(result, R_NamesSymbol, nattrib);
 	    UNPROTECT(2); /* attrib, nattrib */
 	}
@@ -305,6 +583,143 @@ SEXP int_arraySubscript(int dim, SEXP s, SEXP dims, SEXP x, SEXP call);
 	}							\
     } while (0)
 
+/* Matrix and array subsetting of atomic vectors with a data pointer.
+   The result is filled a column (a run along the first dimension) at
+   a time, column j being taken from x at the offset coloff[j] (or
+   being all NA if that is negative) with the row subscripts psr.  The
+   offsets and the row subscripts are checked before filling starts,
+   so that filling cannot fail and can be done by R_num_math_threads
+   threads, each handling whole columns.  Contiguous rows are copied
+   with memcpy, other rows are gathered by a loop without branches
+   unless there are NA row subscripts. */
+
+#define GATHER_THREADS_MIN_N 100000
+
+static R_INLINE int gather_nthreads(R_xlen_t n, R_xlen_t ncol)
+{
+#ifdef _OPENMP
+    if (n >= GATHER_THREADS_MIN_N && ncol > 1 && R_num_math_threads > 1)
+	return R_num_math_threads;
+#endif
+    return 1;
+}
+
+static R_INLINE Rboolean gatherable(SEXP x)
+{
+    switch(TYPEOF(x)) {
+    case LGLSXP:
+    case INTSXP:
+    case REALSXP:
+    case CPLXSXP:
+    case RAWSXP:
+	return DATAPTR_OR_NULL(x) != NULL;
+    default:
+	return FALSE;
+    }
+}
+
+static R_INLINE size_t gather_eltsize(SEXPTYPE type)
+{
+    switch(type) {
+    case LGLSXP:
+    case INTSXP: return sizeof(int);
+    case REALSXP: return sizeof(double);
+    case CPLXSXP: return sizeof(Rcomplex);
+    default: return sizeof(Rbyte);
+    }
+}
+
+#define GATHER_COLUMN(TYPE, NAVAL) do {					\
+	TYPE *py = (TYPE *) dst;					\
+	const TYPE *px = (const TYPE *) src;				\
+	if (src == NULL)						\
+	    for (R_xlen_t i = 0; i < nrs; i++)				\
+		py[i] = NAVAL;						\
+	else if (rowNA)							\
+	    for (R_xlen_t i = 0; i < nrs; i++)				\
+		py[i] = psr[i] == NA_INTEGER ? NAVAL : px[psr[i] - 1];	\
+	else								\
+	    for (R_xlen_t i = 0; i < nrs; i++)				\
+		py[i] = px[psr[i] - 1];					\
+    } while (0)
+
+/* src is NULL for an NA column */
+static void gatherColumn(SEXPTYPE type, void *dst, const void *src,
+			 const int *psr, R_xlen_t nrs, Rboolean rowNA)
+{
+    switch(type) {
+    case LGLSXP:
+    case INTSXP:
+	GATHER_COLUMN(int, NA_INTEGER);
+	break;
+    case REALSXP:
+	GATHER_COLUMN(double, NA_REAL);
+	break;
+    case CPLXSXP:
+	{
+	    Rcomplex NA_CPLX = { .r = NA_REAL, .i = NA_REAL };
+	    GATHER_COLUMN(Rcomplex, NA_CPLX);
+	}
+	break;
+    case RAWSXP:
+	GATHER_COLUMN(Rbyte, (Rbyte) 0);
+	break;
+    default:
+	break;
+    }
+}
+
+static void gatherColumns(SEXP result, SEXP x, const int *psr, R_xlen_t nrs,
+			  const R_xlen_t *coloff, R_xlen_t ncol)
+{
+    SEXPTYPE type = TYPEOF(x);
+    size_t size = gather_eltsize(type);
+    char *py = (char *) DATAPTR(result);
+    const char *px = (const char *) DATAPTR_OR_NULL(x);
+    Rboolean rowNA = FALSE, contig = nrs > 0;
+    R_xlen_t r0 = nrs > 0 ? psr[0] - 1 : 0;
+    for (R_xlen_t i = 0; i < nrs; i++)
+	if (psr[i] == NA_INTEGER) {
+	    rowNA = TRUE;
+	    contig = FALSE;
+	    break;
+	}
+	else if (psr[i] != r0 + 1 + i)
+	    contig = FALSE;
+
+    int nthreads = gather_nthreads(nrs * ncol, ncol);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(type, size, py, px, psr, nrs, coloff, ncol, \
+			       rowNA, contig, r0)
+#endif
+    for (R_xlen_t j = 0; j < ncol; j++) {
+	char *dst = py + j * nrs * size;
+	if (coloff[j] >= 0 && contig)
+	    memcpy(dst, px + (coloff[j] + r0) * size, nrs * size);
+	else
+	    gatherColumn(type, dst, coloff[j] < 0 ? NULL : px + coloff[j] * size,
+			 psr, nrs, rowNA);
+    }
+}
+
+/* A view for m[sr, sc] if its elements are equally spaced in m, that
+   is for contiguous rows of a single column, contiguous columns with
+   all rows, or equally spaced columns of a single row. */
+static SEXP matrixSubsetView(SEXP x, SEXP sr, SEXP sc, int nr, int nc)
+{
+    R_xlen_t nrs = XLENGTH(sr), ncs = XLENGTH(sc), r0, rd, c0, cd;
+    if (nrs * ncs < SUBSET_VIEW_MIN_N ||
+	!arithSubscript(sr, nr, &r0, &rd) || !arithSubscript(sc, nc, &c0, &cd))
+	return NULL;
+    R_xlen_t first = r0 + c0 * nr;
+    if (nrs == 1)
+	return R_subset_view(x, first, cd * nr, ncs);
+    if (rd == 1 && (ncs == 1 || (nrs == nr && cd == 1)))
+	return R_subset_view(x, first, 1, nrs * ncs);
+    return NULL;
+}
+
 static SEXP MatrixSubset(SEXP x, SEXP s, SEXP call, int drop)
 {
     SEXP attr, result, sr, sc, dim;
@@ -327,11 +742,36 @@ static SEXP MatrixSubset(SEXP x, SEXP s, SEXP call, int drop)
 	error(_("dimensions would exceed maximum size of array"));
     PROTECT(sr);
     PROTECT(sc);
+    if (R_SubsetViews &&
+	(result = matrixSubsetView(x, sr, sc, nr, nc)) != NULL) {
+	PROTECT(result);
+	goto attributes;
+    }
     result = allocVector(TYPEOF(x), (R_xlen_t) nrs * (R_xlen_t) ncs);
     const int *psr = INTEGER_RO(sr);
     const int *psc = INTEGER_RO(sc);
     PROTECT(result);
-    switch(TYPEOF(x)) {
+    if (nrs > 0 && gatherable(x)) {
+	const void *vmax = vmaxget();
+	R_xlen_t *coloff = (R_xlen_t *) R_alloc(ncs, sizeof(R_xlen_t));
+	for (j = 0; j < ncs; j++) {
+	    jj = psc[j];
+	    if (jj == NA_INTEGER)
+		coloff[j] = -1;
+	    else if (jj < 1 || jj > nc)
+		errorcallOutOfBounds(x, 0, jj, call);
+	    else
+		coloff[j] = (jj - 1) * (R_xlen_t) nr;
+	}
+	for (i = 0; i < nrs; i++) {
+	    ii = psr[i];
+	    if (ii != NA_INTEGER && (ii < 1 || ii > nr))
+		errorcallOutOfBounds(x, 1, ii, call);
+	}
+	gatherColumns(result, x, psr, nrs, coloff, ncs);
+	vmaxset(vmax);
+    }
+    else switch(TYPEOF(x)) {
     case LGLSXP:
 	MATRIX_SUBSET_LOOP(LOGICAL0(result)[ij] = LOGICAL_ELT(x, iijj),
 			   LOGICAL0(result)[ij] = NA_LOGICAL);
@@ -370,6 +810,7 @@ static SEXP MatrixSubset(SEXP x, SEXP s, SEXP call, int drop)
 	break;
     }
 
+ attributes:
     if(nrs >= 0 && ncs >= 0) {
 	PROTECT(attr = allocVector(INTSXP, 2));
 	INTEGER0(attr)[0] = nrs;
@@ -502,7 +943,28 @@ static SEXP ArraySubset(SEXP x, SEXP s, SEXP call, int drop)
 
     /* Transfer the subset elements from "x" to "a". */
     PROTECT(result = allocVector(mode, n));
-    switch (mode) {
+    if (n > 0 && gatherable(x)) {
+	/* offsets of the columns, running through the subscripts of
+	   dimensions 2 to k in column-major order */
+	R_xlen_t ncol = n / bound[0];
+	R_xlen_t *coloff = (R_xlen_t *) R_alloc(ncol, sizeof(R_xlen_t));
+	for (R_xlen_t j = 0; j < ncol; j++) {
+	    R_xlen_t off = 0;
+	    for (int d = 1; d < k; d++) {
+		int jj = subs[d][indx[d]];
+		if (jj == NA_INTEGER) {
+		    off = -1;
+		    break;
+		}
+		off += (jj - 1) * offset[d];
+	    }
+	    coloff[j] = off;
+	    for (int d = 1; d < k && ++indx[d] >= bound[d]; d++)
+		indx[d] = 0;
+	}
+	gatherColumns(result, x, subs[0], bound[0], coloff, ncol);
+    }
+    else switch (mode) {
     case LGLSXP:
 	ARRAY_SUBSET_LOOP(LOGICAL0(result)[i] = LOGICAL_ELT(x, ii),
 			  LOGICAL0(result)[i] = NA_LOGICAL);
@@ -1346,6 +1808,15 @@ attribute_hidden SEXP R_subset3_dflt(SEXP x, SEXP input, SEXP call)
 	int havematch;
 	SEXP nlist = getAttrib(x, R_NamesSymbol);
 
+	/* an exact match by the name index, if it can be used */
+	if (R_lookupNameIndex(nlist, input, &imatch) && imatch >= 0) {
+	    y = VECTOR_ELT(x, imatch);
+	    RAISE_NAMED(y, NAMED(x));
+	    UNPROTECT(2); /* input, x */
+	    return y;
+	}
+	imatch = -1;
+
 	n = xlength(nlist);
 	havematch = 0;
 	for (i = 0 ; i < n ; i = i + 1) {
@@ -29,6 +29,7 @@
 #include <float.h> // for DBL_MAX
 
 #include "duplicate.h"
+#include "bitset.h"
 
 #define R_MSG_type	_("invalid 'type' (%s) of argument")
 #define imax2(x, y) ((x < y) ? y : x)
@@ -47,6 +48,303 @@
 #define DbgP3(s,a,b)
 #endif
 
+/* Blocked reductions.
+
+   Long vectors are cut into blocks of SUMMARY_BLOCK elements at fixed
+   boundaries.  Each block is reduced on its own, possibly in a
+   different thread, and the per-block results are then combined in a
+   fixed order, so the result does not depend on the number of threads
+   (R_num_math_threads) used.
+
+   For integer sums and for min() and max() this gives exactly the
+   sequential result.  Sums and products of doubles are only computed
+   this way if options(summation) is not "ldouble", the default which
+   keeps the sequential long double accumulation:
+
+   "double":   each block is summed using four double accumulators
+	       (which the compiler can keep in SIMD registers) and the
+	       block sums are added pairwise.
+   "pairwise": as "double", but each block is itself summed pairwise
+	       from sums of SUMMARY_LEAF elements, so that the error
+	       bound grows with log(n) rather than with n.
+   "kahan":    Kahan-Babuska-Neumaier compensated summation in four
+	       lanes, with the block sums and their compensations
+	       accumulated in the same way.
+
+   Products use the "double" method for all three.
+*/
+#define SUMMARY_BLOCK 4096
+#define SUMMARY_LEAF 128
+#define SUMMARY_THREADS_MIN_N 100000
+
+static R_INLINE int summary_nthreads(R_xlen_t n)
+{
+#ifdef _OPENMP
+    if (n >= SUMMARY_THREADS_MIN_N && R_num_math_threads > 1)
+	return R_num_math_threads;
+#endif
+    return 1;
+}
+
+#define SUMMARY_NBLOCKS(n) (((n) + SUMMARY_BLOCK - 1) / SUMMARY_BLOCK)
+#define SUMMARY_BLOCK_LEN(n, b) \
+    ((n) - (b) * SUMMARY_BLOCK < SUMMARY_BLOCK ? \
+     (n) - (b) * SUMMARY_BLOCK : SUMMARY_BLOCK)
+
+/* The term for x[k]: NaNs count as zero when they are to be removed.
+   The loops are written separately for narm = FALSE so that they have
+   no branches and can be vectorized. */
+#define SUM_TERM(v) (ISNAN(v) ? 0.0 : (v) - shift)
+
+/* Neumaier's variant of Kahan summation: add v to s, accumulating the
+   rounding error in c. */
+static R_INLINE void kbn_add(double *s, double *c, double v)
+{
+    double t = *s + v;
+    *c += fabs(*s) >= fabs(v) ? (*s - t) + v : (v - t) + *s;
+    *s = t;
+}
+
+static double rsum_lanes(const double *x, R_xlen_t n, double shift,
+			 Rboolean narm)
+{
+    double s[4] = {0.0, 0.0, 0.0, 0.0};
+    R_xlen_t k = 0;
+    if (narm)
+	for (; k + 4 <= n; k += 4)
+	    for (int j = 0; j < 4; j++)
+		s[j] += SUM_TERM(x[k + j]);
+    else
+	for (; k + 4 <= n; k += 4)
+	    for (int j = 0; j < 4; j++)
+		s[j] += x[k + j] - shift;
+    for (; k < n; k++)
+	s[0] += narm ? SUM_TERM(x[k]) : x[k] - shift;
+    return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+static double rsum_lanes_kbn(const double *x, R_xlen_t n, double shift,
+			     Rboolean narm, double *comp)
+{
+    double s[4] = {0.0, 0.0, 0.0, 0.0}, c[4] = {0.0, 0.0, 0.0, 0.0};
+    R_xlen_t k = 0;
+#define KBN_LANES(TERM) \
+    for (; k + 4 <= n; k += 4) \
+	for (int j = 0; j < 4; j++) { \
+	    double v = TERM(x[k + j]), t = s[j] + v; \
+	    double big = fabs(s[j]) >= fabs(v) ? s[j] : v; \
+	    double small = big == s[j] ? v : s[j]; \
+	    c[j] += (big - t) + small; \
+	    s[j] = t; \
+	}
+#define PLAIN_TERM(v) ((v) - shift)
+    if (narm) {
+	KBN_LANES(SUM_TERM);
+    }
+    else {
+	KBN_LANES(PLAIN_TERM);
+    }
+#undef KBN_LANES
+#undef PLAIN_TERM
+    for (; k < n; k++)
+	kbn_add(s, c, narm ? SUM_TERM(x[k]) : x[k] - shift);
+    double sum = s[0], cc = (c[0] + c[1]) + (c[2] + c[3]);
+    for (int j = 1; j < 4; j++)
+	kbn_add(&sum, &cc, s[j]);
+    *comp = cc;
+    return sum;
+}
+
+/* Sum of the terms for x[0:(n-1)], n <= SUMMARY_BLOCK, by 'method';
+   *comp is set to the compensation ("kahan") or zero.  Returns the
+   number of terms used. */
+static R_xlen_t rsum_block(const double *x, R_xlen_t n, double shift,
+			   Rboolean narm, SUMMATION_TYPE method,
+			   double *sum, double *comp)
+{
+    *comp = 0.0;
+    switch (method) {
+    case SUMMATION_KAHAN:
+	*sum = rsum_lanes_kbn(x, n, shift, narm, comp);
+	break;
+    case SUMMATION_PAIRWISE:
+    {
+	double part[SUMMARY_BLOCK / SUMMARY_LEAF];
+	int np = 0;
+	part[0] = 0.0; /* -Wall */
+	for (R_xlen_t k = 0; k < n; k += SUMMARY_LEAF)
+	    part[np++] = rsum_lanes(x + k, n - k < SUMMARY_LEAF ?
+				    n - k : SUMMARY_LEAF, shift, narm);
+	for (int step = 1; step < np; step *= 2)
+	    for (int j = 0; j + step < np; j += 2 * step)
+		part[j] += part[j + step];
+	*sum = part[0];
+	break;
+    }
+    default:
+	*sum = rsum_lanes(x, n, shift, narm);
+    }
+    if (!narm) return n;
+    R_xlen_t m = 0;
+    for (R_xlen_t k = 0; k < n; k++)
+	m += !ISNAN(x[k]);
+    return m;
+}
+
+static R_xlen_t rprod_block(const double *x, R_xlen_t n, Rboolean narm,
+			    double *prod)
+{
+    double p[4] = {1.0, 1.0, 1.0, 1.0};
+    R_xlen_t k = 0, m = n;
+    if (narm) {
+	m = 0;
+	for (k = 0; k < n; k++)
+	    if (!ISNAN(x[k])) {
+		p[0] *= x[k];
+		m++;
+	    }
+    }
+    else {
+	for (; k + 4 <= n; k += 4)
+	    for (int j = 0; j < 4; j++)
+		p[j] *= x[k + j];
+	for (; k < n; k++)
+	    p[0] *= x[k];
+    }
+    *prod = (p[0] * p[1]) * (p[2] * p[3]);
+    return m;
+}
+
+/* Combines the block results in block order: by compensated summation
+   for "kahan", otherwise pairwise, a partial result being merged with
+   its left neighbour as soon as both cover the same number of blocks.
+   This needs no storage for the block results. */
+typedef struct {
+    Rboolean kbn, prod;
+    int top;
+    int level[64];
+    double val[64];
+    double s, c;
+} rsum_combiner;
+
+static void rsum_combine_init(rsum_combiner *a, SUMMATION_TYPE method,
+			      Rboolean prod)
+{
+    a->kbn = !prod && method == SUMMATION_KAHAN;
+    a->prod = prod;
+    a->top = 0;
+    a->s = a->c = 0.0;
+}
+
+static void rsum_combine_add(rsum_combiner *a, double s, double c)
+{
+    if (a->kbn) {
+	kbn_add(&a->s, &a->c, s);
+	a->c += c;
+	return;
+    }
+    int level = 0;
+    while (a->top > 0 && a->level[a->top - 1] == level) {
+	a->top--;
+	s = a->prod ? a->val[a->top] * s : a->val[a->top] + s;
+	level++;
+    }
+    a->level[a->top] = level;
+    a->val[a->top++] = s;
+}
+
+static double rsum_combine_result(rsum_combiner *a)
+{
+    if (a->kbn) /* an infinite sum makes the compensation NaN */
+	return R_FINITE(a->s) ? a->s + a->c : a->s;
+    if (a->top == 0) return a->prod ? 1.0 : 0.0;
+    double s = a->val[--a->top];
+    while (a->top > 0) {
+	a->top--;
+	s = a->prod ? a->val[a->top] * s : a->val[a->top] + s;
+    }
+    return s;
+}
+
+/* Sum of a double array by the method of options(summation), which
+   must not be "ldouble".  Used by colSums() and colMeans(). */
+attribute_hidden double R_rsum_array(const double *x, R_xlen_t n,
+				     Rboolean narm, R_xlen_t *cnt)
+{
+    SUMMATION_TYPE method = R_Summation;
+    rsum_combiner a;
+    R_xlen_t m = 0;
+    rsum_combine_init(&a, method, FALSE);
+    for (R_xlen_t b = 0; b < SUMMARY_NBLOCKS(n); b++) {
+	double s, c;
+	m += rsum_block(x + b * SUMMARY_BLOCK, SUMMARY_BLOCK_LEN(n, b), 0.0,
+			narm, method, &s, &c);
+	rsum_combine_add(&a, s, c);
+    }
+    *cnt = m;
+    return rsum_combine_result(&a);
+}
+
+/* Sum of x[k] - shift (or product of x[k]) for a double vector, using
+   the blocked methods above.  Returns TRUE if any term was used. */
+static Rboolean rsum_blocked(SEXP sx, double *value, double shift,
+			     Rboolean narm, Rboolean prod)
+{
+    SUMMATION_TYPE method = R_Summation;
+    R_xlen_t n = XLENGTH(sx), nb = SUMMARY_NBLOCKS(n), cnt = 0;
+    const double *x = REAL_OR_NULL(sx);
+    int nthreads = summary_nthreads(n);
+    rsum_combiner a;
+    rsum_combine_init(&a, method, prod);
+
+    if (x != NULL && nthreads > 1) {
+	const void *vmax = vmaxget();
+	double *bs = (double *) R_alloc(nb, sizeof(double));
+	double *bc = (double *) R_alloc(nb, sizeof(double));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(x, bs, bc, n, nb, shift, narm, prod, method) \
+    reduction(+:cnt)
+#endif
+	for (R_xlen_t b = 0; b < nb; b++) {
+	    R_xlen_t len = SUMMARY_BLOCK_LEN(n, b);
+	    const double *xb = x + b * SUMMARY_BLOCK;
+	    if (prod) {
+		cnt += rprod_block(xb, len, narm, bs + b);
+		bc[b] = 0.0;
+	    }
+	    else
+		cnt += rsum_block(xb, len, shift, narm, method, bs + b, bc + b);
+	}
+	for (R_xlen_t b = 0; b < nb; b++)
+	    rsum_combine_add(&a, bs[b], bc[b]);
+	vmaxset(vmax);
+    }
+    else {
+	const void *vmax = vmaxget();
+	double *buf = NULL;
+	if (x == NULL)
+	    buf = (double *) R_alloc(SUMMARY_BLOCK, sizeof(double));
+	for (R_xlen_t b = 0; b < nb; b++) {
+	    R_xlen_t len = SUMMARY_BLOCK_LEN(n, b);
+	    const double *xb;
+	    double s, c = 0.0;
+	    if (x != NULL)
+		xb = x + b * SUMMARY_BLOCK;
+	    else {
+		REAL_GET_REGION(sx, b * SUMMARY_BLOCK, len, buf);
+		xb = buf;
+	    }
+	    cnt += prod ? rprod_block(xb, len, narm, &s) :
+		rsum_block(xb, len, shift, narm, method, &s, &c);
+	    rsum_combine_add(&a, s, c);
+	}
+	vmaxset(vmax);
+    }
+    *value = rsum_combine_result(&a);
+    return cnt > 0;
+}
+
 #ifdef LONG_INT
 # define isum_INT LONG_INT
 static int isum(SEXP sx, isum_INT *value, Rboolean narm, SEXP call)
@@ -74,6 +372,56 @@ static int isum(SEXP sx, isum_INT *value, Rboolean narm, SEXP call)
 # define ISUM_OVERFLOW_CHECK do { } while(0)
 #endif
 
+    const int *px = INTEGER_OR_NULL(sx);
+    R_xlen_t n = XLENGTH(sx);
+    int nthreads = summary_nthreads(n);
+    if (px != NULL && nthreads > 1) {
+	/* Block sums of at most SUMMARY_BLOCK ints cannot overflow;
+	   adding them up in order is exact, as long as it does not
+	   overflow, too. */
+	R_xlen_t nb = SUMMARY_NBLOCKS(n);
+	const void *vmax = vmaxget();
+	LONG_INT *bs = (LONG_INT *) R_alloc(nb, sizeof(LONG_INT));
+	int *bu = (int *) R_alloc(nb, sizeof(int));
+	int na = NA_INTEGER;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(px, bs, bu, n, nb, narm, na)
+#endif
+	for (R_xlen_t b = 0; b < nb; b++) {
+	    R_xlen_t len = SUMMARY_BLOCK_LEN(n, b);
+	    const int *x = px + b * SUMMARY_BLOCK;
+	    LONG_INT bsum = 0;
+	    int bupd = 0;
+	    for (R_xlen_t k = 0; k < len; k++) {
+		if (x[k] != na) {
+		    bupd = 1;
+		    bsum += x[k];
+		} else if (!narm) {
+		    bupd = na;
+		    break;
+		}
+	    }
+	    bs[b] = bsum;
+	    bu[b] = bupd;
+	}
+	for (R_xlen_t b = 0; b < nb; b++) {
+	    if (bu[b] == NA_INTEGER) {
+		vmaxset(vmax);
+		return NA_INTEGER;
+	    }
+	    if (bu[b]) updated = 1;
+	    s += bs[b];
+	    if (s > 9000000000000000L || s < -9000000000000000L) {
+		vmaxset(vmax);
+		return 42; /* overflow: switch to irsum() */
+	    }
+	}
+	vmaxset(vmax);
+	*value = s;
+	return updated;
+    }
+
     /**** assumes INTEGER(sx) and LOGICAL(sx) are identical!! */
     ITERATE_BY_REGION(sx, x, i, nbatch, int, INTEGER, {
 	    for (R_xlen_t k = 0; k < nbatch; k++) {
@@ -151,6 +499,9 @@ static Rboolean risum(SEXP sx, double *value, Rboolean narm)
 
 static Rboolean rsum(SEXP sx, double *value, Rboolean narm)
 {
+    if (R_Summation != SUMMATION_LDOUBLE)
+	return rsum_blocked(sx, value, 0.0, narm, FALSE);
+
     LDOUBLE s = 0.0;
     Rboolean updated = FALSE;
 
@@ -212,11 +563,63 @@ static Rboolean imin(SEXP sx, int *value, Rboolean narm)
     return updated;
 }
 
+/* Update the running minimum (or maximum) 's' with x[0:(n-1)] in the
+   same way as rmin() and rmax() do. */
+static Rboolean rminmax_block(const double *x, R_xlen_t n, double *value,
+			      Rboolean updated, Rboolean narm, Rboolean max)
+{
+    double s = *value;
+    for (R_xlen_t k = 0; k < n; k++) {
+	if (ISNAN(x[k])) {/* Na(N) */
+	    if (!narm) {
+		if(!ISNA(s)) s = x[k]; /* so any NA trumps all NaNs */
+		if(!updated) updated = TRUE;
+	    }
+	}
+	else if (!updated || (max ? x[k] > s : x[k] < s)) {
+	    s = x[k];
+	    if(!updated) updated = TRUE;
+	}
+    }
+    *value = s;
+    return updated;
+}
+
+/* Threaded rmin() and rmax(): the results of the blocks are combined
+   in order by the same rule, so this gives the sequential result. */
+static Rboolean rminmax_threaded(const double *x, R_xlen_t n, int nthreads,
+				 double *value, Rboolean narm, Rboolean max)
+{
+    R_xlen_t nb = SUMMARY_NBLOCKS(n), nu = 0;
+    const void *vmax = vmaxget();
+    double *bv = (double *) R_alloc(nb, sizeof(double));
+    Rboolean *bu = (Rboolean *) R_alloc(nb, sizeof(Rboolean));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(x, bv, bu, n, nb, narm, max)
+#endif
+    for (R_xlen_t b = 0; b < nb; b++) {
+	bv[b] = 0.0;
+	bu[b] = rminmax_block(x + b * SUMMARY_BLOCK, SUMMARY_BLOCK_LEN(n, b),
+			      bv + b, FALSE, narm, max);
+    }
+    for (R_xlen_t b = 0; b < nb; b++)
+	if (bu[b]) bv[nu++] = bv[b];
+    Rboolean updated = rminmax_block(bv, nu, value, FALSE, narm, max);
+    vmaxset(vmax);
+    return updated;
+}
+
 static Rboolean rmin(SEXP sx, double *value, Rboolean narm)
 {
     double s = 0.0; /* -Wall */
     Rboolean updated = FALSE;
 
+    const double *px = REAL_OR_NULL(sx);
+    int nthreads = summary_nthreads(XLENGTH(sx));
+    if (px != NULL && nthreads > 1)
+	return rminmax_threaded(px, XLENGTH(sx), nthreads, value, narm, FALSE);
+
     /* s = R_PosInf; */
     ITERATE_BY_REGION(sx, x, i, nbatch, double, REAL, {
 	    for (R_xlen_t k = 0; k < nbatch; k++) {
@@ -288,6 +691,11 @@ static Rboolean rmax(SEXP sx, double *value, Rboolean narm)
     double s = 0.0 /* -Wall */;
     Rboolean updated = FALSE;
 
+    const double *px = REAL_OR_NULL(sx);
+    int nthreads = summary_nthreads(XLENGTH(sx));
+    if (px != NULL && nthreads > 1)
+	return rminmax_threaded(px, XLENGTH(sx), nthreads, value, narm, TRUE);
+
     ITERATE_BY_REGION(sx, x, iii, nbatch, double, REAL, {
 	    for (R_xlen_t k = 0; k < nbatch; k++) {
 		if (ISNAN(x[k])) {/* Na(N) */
@@ -366,6 +774,9 @@ static Rboolean iprod(SEXP sx, double *value, Rboolean narm)
 
 static Rboolean rprod(SEXP sx, double *value, Rboolean narm)
 {
+    if (R_Summation != SUMMATION_LDOUBLE)
+	return rsum_blocked(sx, value, 0.0, narm, TRUE);
+
     LDOUBLE s = 1.0;
     Rboolean updated = FALSE;
 
@@ -479,6 +890,16 @@ static R_INLINE SEXP integer_mean(SEXP x)
 static R_INLINE SEXP real_mean(SEXP x)
 {
     R_xlen_t n = XLENGTH(x);
+    if (R_Summation != SUMMATION_LDOUBLE) {
+	double sd, t;
+	rsum_blocked(x, &sd, 0.0, FALSE, FALSE);
+	sd /= n;
+	if (R_FINITE(sd)) {
+	    rsum_blocked(x, &t, sd, FALSE, FALSE);
+	    return ScalarReal(sd + t/n);
+	}
+	/* otherwise the sum may just have overflowed: fall through */
+    }
     LDOUBLE s = 0.0;
     ITERATE_BY_REGION(x, dx, i, nbatch, double, REAL, {
 	    for (R_xlen_t k = 0; k < nbatch; k++)
@@ -591,6 +1012,8 @@ attribute_hidden SEXP do_summary(SEXP call, SEXP op, SEXP args, SEXP env)
 		toret = ALTINTEGER_SUM(vec, narm);
 	    else if (TYPEOF(vec) == REALSXP)
 		toret = ALTREAL_SUM(vec, narm);
+	    else if (TYPEOF(vec) == LGLSXP)
+		toret = ALTLOGICAL_SUM(vec, narm);
 	    break; 
 	case 2:
 	    if(TYPEOF(vec) == INTSXP) 
@@ -1127,44 +1550,68 @@ attribute_hidden SEXP do_which(SEXP call, SEXP op, SEXP args, SEXP rho)
 	error(_("argument to 'which' is not logical"));
     R_xlen_t len = xlength(v), i, j = 0;
     SEXP ans;
+    const uint64_t *bits, *nas;
+    if (R_bitset_logical_words(v, &bits, &nas)) {
+	/* visit the set bits only */
+	R_xlen_t nw = R_BITSET_WORDS(len), cnt = R_bitset_count(bits, len);
 #ifdef LONG_VECTOR_SUPPORT
-    if (len > R_SHORT_LEN_MAX) {
-    R_xlen_t xoffset = 1; // 1 for 1-based indexing of response
-    double *buf = (double *) R_alloc(len, sizeof(double));
-    ITERATE_BY_REGION(v, ptr, idx, nb, int, LOGICAL, {
-	    for(R_xlen_t i = 0; i < nb; i++) {
-		if(ptr[i] == TRUE) {
-		    buf[j] = (double)(xoffset + i); // offset has +1 built in
-		    j++;
-		}
-	    }
-	    xoffset += nb; // move to beginning of next buffer (+1 since R-based)
-	});
-
-    len = j;
-    PROTECT(ans = allocVector(REALSXP, len));
-    // buf has doubles in it, memcopy if we found any indices.
-    if(len) memcpy(REAL(ans), buf, sizeof(double) * len);
-    } else
+	if (len > R_SHORT_LEN_MAX) {
+	    PROTECT(ans = allocVector(REALSXP, cnt));
+	    double *pa = REAL(ans);
+	    for (R_xlen_t w = 0; w < nw; w++)
+		for (uint64_t b = bits[w]; b; b &= b - 1)
+		    pa[j++] = (double) (w * 64 + R_bitset_ctz(b) + 1);
+	} else
 #endif
-    {
-    int ioffset = 1;
-    int *buf = (int *) R_alloc(len, sizeof(int));
-    /* use iteration macros to be ALTREP safe and pull ptr retrieval out of tight loop */
-    ITERATE_BY_REGION(v, ptr, idx, nb, int, LOGICAL, {
-	    for(int i = 0; i < nb; i++) {
-		if(ptr[i] == TRUE) {
-		    buf[j] = ioffset + i; // offset has +1 built in
-		    j++;
-		}
-	    }
-	    ioffset += nb; // move to beginning of next buffer
-	});
+	{
+	    PROTECT(ans = allocVector(INTSXP, cnt));
+	    int *pa = INTEGER(ans);
+	    for (R_xlen_t w = 0; w < nw; w++)
+		for (uint64_t b = bits[w]; b; b &= b - 1)
+		    pa[j++] = (int) (w * 64 + R_bitset_ctz(b) + 1);
+	}
+	len = cnt;
+    }
+    else {
+#ifdef LONG_VECTOR_SUPPORT
+	if (len > R_SHORT_LEN_MAX) {
+	    R_xlen_t xoffset = 1; // 1 for 1-based indexing of response
+	    double *buf = (double *) R_alloc(len, sizeof(double));
+	    ITERATE_BY_REGION(v, ptr, idx, nb, int, LOGICAL, {
+		    for(R_xlen_t i = 0; i < nb; i++) {
+			if(ptr[i] == TRUE) {
+			    buf[j] = (double)(xoffset + i); // offset has +1 built in
+			    j++;
+			}
+		    }
+		    xoffset += nb; // move to beginning of next buffer (+1 since R-based)
+		});
+
+	    len = j;
+	    PROTECT(ans = allocVector(REALSXP, len));
+	    // buf has doubles in it, memcopy if we found any indices.
+	    if(len) memcpy(REAL(ans), buf, sizeof(double) * len);
+	} else
+#endif
+	{
+	    int ioffset = 1;
+	    int *buf = (int *) R_alloc(len, sizeof(int));
+	    /* use iteration macros to be ALTREP safe and pull ptr retrieval out of tight loop */
+	    ITERATE_BY_REGION(v, ptr, idx, nb, int, LOGICAL, {
+		    for(int i = 0; i < nb; i++) {
+			if(ptr[i] == TRUE) {
+			    buf[j] = ioffset + i; // offset has +1 built in
+			    j++;
+			}
+		    }
+		    ioffset += nb; // move to beginning of next buffer
+		});
 
-    len = j;
-    // buf has ints in it and we're returning ints, memcopy if we found any indices;
-    PROTECT(ans = allocVector(INTSXP, len));
-    if(len) memcpy(INTEGER(ans), buf, sizeof(int) * len);
+	    len = j;
+	    // buf has ints in it and we're returning ints, memcopy if we found any indices;
+	    PROTECT(ans = allocVector(INTSXP, len));
+	    if(len) memcpy(INTEGER(ans), buf, sizeof(int) * len);
+	}
     }
 
     SEXP v_nms = getAttrib(v, R_NamesSymbol);
@@ -29,6 +29,8 @@
 #include <Internal.h>
 #include <R_ext/Altrep.h>
 #include <R_ext/Itermacros.h>
+#include <float.h>
+#include <stdint.h>
 
 /* inline version of function R_NaN_is_R_NA defined in arithmetic.c */
 /* may not be needed if LTO is enabled */
@@ -462,7 +464,8 @@ static void MKsetup(R_xlen_t n, HashData *d, R_xlen_t nmax)
 }
 
 #define IMAX 4294967296L
-static void HashTableSetup(SEXP x, HashData *d, R_xlen_t nmax)
+/* set up d for x, without allocating the table */
+static void HashTableSetup0(SEXP x, HashData *d, R_xlen_t nmax)
 {
     d->useUTF8 = FALSE;
     d->useCache = TRUE;
@@ -515,6 +518,11 @@ static void HashTableSetup(SEXP x, HashData *d, R_xlen_t nmax)
     default:
 	UNIMPLEMENTED_TYPE("HashTableSetup", x);
     }
+}
+
+static void HashTableSetup(SEXP x, HashData *d, R_xlen_t nmax)
+{
+    HashTableSetup0(x, d, nmax);
 #ifdef LONG_VECTOR_SUPPORT
     d->isLong = IS_LONG_VEC(x);
     if (d->isLong) {
@@ -561,6 +569,348 @@ static int isDuplicated(SEXP x, R_xlen_t indx, HashData *d)
     return 0;
 }
 
+/* Hash indices.
+
+   With options(hash.index = TRUE), the hash table built over a long
+   integer, double or character vector by match(), duplicated() or
+   unique() is kept for reuse by later calls on the same vector.  The
+   tables are held by weak references keyed by their vector, in a small
+   cache with round-robin replacement, so the cache does not keep the
+   vectors alive.  The reference does count for the vector, so R code
+   modifying it duplicates it first, and a kept table always matches
+   its vector.
+
+   Only tables built without 'nmax' and 'incomparables' are kept, and
+   for character vectors only if all strings are cached, native and not
+   bytes: such strings are hashed and compared by address, so the table
+   does not depend on the other argument of match().
+*/
+#define HASH_INDEX_MIN_N 1000
+#define HASH_INDEX_CACHE_SIZE 8
+static SEXP HashIndexCache = NULL;
+static int HashIndexNext = 0;
+
+static Rboolean plainStrings(SEXP x)
+{
+    R_xlen_t n = XLENGTH(x);
+    for (R_xlen_t i = 0; i < n; i++) {
+	SEXP s = STRING_ELT(x, i);
+	if (IS_BYTES(s) || ENC_KNOWN(s) || !IS_CACHED(s))
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+static Rboolean hashIndexable(SEXP x)
+{
+    if (!R_HashIndex)
+	return FALSE;
+    switch(TYPEOF(x)) {
+    case INTSXP:
+    case REALSXP:
+    case STRSXP: break;
+    default: return FALSE;
+    }
+    return XLENGTH(x) >= HASH_INDEX_MIN_N && !IS_LONG_VEC(x);
+}
+
+static int findHashIndex(SEXP x)
+{
+    if (HashIndexCache != NULL)
+	for (int i = 0; i < HASH_INDEX_CACHE_SIZE; i++) {
+	    SEXP w = VECTOR_ELT(HashIndexCache, i);
+	    if (w != R_NilValue && R_WeakRefKey(w) == x)
+		return i;
+	}
+    return -1;
+}
+
+static void dropHashIndex(int i)
+{
+    SEXP w = VECTOR_ELT(HashIndexCache, i);
+    if (w != R_NilValue) {
+	R_RunWeakRefFinalizer(w); /* releases the vector and its table */
+	SET_VECTOR_ELT(HashIndexCache, i, R_NilValue);
+    }
+}
+
+/* Set up d with the kept table of x, if there is one. */
+static Rboolean getHashIndex(SEXP x, HashData *d)
+{
+    if (!hashIndexable(x))
+	return FALSE;
+    int i = findHashIndex(x);
+    if (i < 0)
+	return FALSE;
+    SEXP h = R_WeakRefValue(VECTOR_ELT(HashIndexCache, i));
+    HashTableSetup0(x, d, NA_INTEGER);
+    if (TYPEOF(h) != INTSXP || XLENGTH(h) != d->M) {
+	dropHashIndex(i);
+	return FALSE;
+    }
+#ifdef LONG_VECTOR_SUPPORT
+    d->isLong = FALSE;
+#endif
+    d->HashTable = h;
+    return TRUE;
+}
+
+/* Keep the table of x just built by hashing all of x in order. */
+static void putHashIndex(SEXP x, HashData *d)
+{
+    if (!hashIndexable(x) || d->useUTF8 || !d->useCache ||
+	(TYPEOF(x) == STRSXP && !plainStrings(x)))
+	return;
+#ifdef LONG_VECTOR_SUPPORT
+    if (d->isLong) return;
+#endif
+    if (HashIndexCache == NULL) {
+	HashIndexCache = allocVector(VECSXP, HASH_INDEX_CACHE_SIZE);
+	R_PreserveObject(HashIndexCache);
+    }
+    int i = findHashIndex(x);
+    if (i < 0) {
+	i = HashIndexNext;
+	HashIndexNext = (HashIndexNext + 1) % HASH_INDEX_CACHE_SIZE;
+    }
+    dropHashIndex(i);
+    SEXP w = R_MakeVectorWeakRef(x, d->HashTable);
+    SET_VECTOR_ELT(HashIndexCache, i, w);
+}
+
+/* index of the first element equal to x[i], which is in the table */
+static R_INLINE R_xlen_t hashIndexFirst(SEXP x, R_xlen_t i, HashData *d)
+{
+    int *h = HTDATA_INT(d);
+    hlen k = d->hash(x, i, d);
+    while (!d->equal(x, h[k], x, i))
+	k = (k + 1) % d->M;
+    return h[k];
+}
+
+attribute_hidden void R_resetHashIndex(void)
+{
+    if (HashIndexCache != NULL)
+	for (int i = 0; i < HASH_INDEX_CACHE_SIZE; i++)
+	    dropHashIndex(i);
+}
+
+/* Partitioned parallel hashing.
+
+   For long integer, double and character vectors, match() and
+   duplicated() can hash using R_num_math_threads threads.  Keys are
+   normalized to 64 bits, so that equal elements have equal keys: the
+   value of an integer, the bits of a double with -0 made 0 and all NAs
+   and all other NaNs made one NA and one NaN, and the address of a
+   string, which is only used when all strings are cached, native and
+   not bytes, so that addresses are equal exactly when strings are.
+
+   The elements of the table are partitioned by the top bits of the
+   mixed keys.  Blocks of the table are counted and scattered by
+   threads, which keeps the indices in each partition increasing.  Each
+   partition then gets its own open addressing table, built by one
+   thread in index order (or reverse order, for fromLast), so the
+   stored index of each key is that of its first (last) occurrence, as
+   in the sequential code.  Probing reads the partition table of each
+   key.  Partitions are sized to fit in cache.
+*/
+#define PHASH_THREADS_MIN_N 100000
+#define PHASH_PART_N 32768
+
+static int phash_nthreads(R_xlen_t n)
+{
+#ifdef _OPENMP
+    if (n >= PHASH_THREADS_MIN_N && n <= INT_MAX && R_num_math_threads > 1)
+	return R_num_math_threads;
+#endif
+    return 1;
+}
+
+static R_INLINE uint64_t phash_key(const void *p, SEXPTYPE type, R_xlen_t i)
+{
+    switch(type) {
+    case INTSXP:
+	return (uint32_t) ((const int *) p)[i];
+    case REALSXP: {
+	double v = ((const double *) p)[i];
+	uint64_t u;
+	if (v == 0.0) v = 0.0;
+	else if (ISNAN(v)) v = R_IsNA(v) ? NA_REAL : R_NaN;
+	memcpy(&u, &v, sizeof(u));
+	return u;
+    }
+    default:
+	return (uint64_t) (uintptr_t) ((const SEXP *) p)[i];
+    }
+}
+
+static R_INLINE uint64_t phash_mix(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return k;
+}
+
+typedef struct {
+    int pbits;
+    int *tstart; /* partition tables, of power of 2 sizes, in 'slab' */
+    int *slab;
+} phash;
+
+static void phash_free(phash *ph)
+{
+    free(ph->tstart); ph->tstart = NULL;
+    free(ph->slab); ph->slab = NULL;
+}
+
+#define PHASH_BLOCK_START(n, nb, b) ((int) ((int64_t) (n) * (b) / (nb)))
+
+/* Build the partition tables for the n keys of p.  If dup is not NULL,
+   it is set to whether each element is a duplicate.  Returns FALSE if
+   memory could not be allocated. */
+static Rboolean phash_build(phash *ph, const void *p, SEXPTYPE type, int n,
+			    Rboolean from_last, int *dup, int nthreads)
+{
+    int pbits = 0;
+    while (pbits < 16 && ((int64_t) PHASH_PART_N << pbits) < n) pbits++;
+    while ((1 << pbits) < 4 * nthreads) pbits++;
+    int P = 1 << pbits, shift = 64 - pbits;
+    int nb = nthreads;
+    size_t ncnt = (size_t) nb * P;
+    int *cnt = calloc(ncnt, sizeof(int)), *pstart = malloc((P + 1) * sizeof(int));
+    int *idx = malloc((size_t) n * sizeof(int));
+    ph->pbits = pbits;
+    ph->slab = NULL;
+    ph->tstart = malloc((P + 1) * sizeof(int));
+    if (!cnt || !pstart || !idx || !ph->tstart) {
+	free(cnt); free(pstart); free(idx); phash_free(ph);
+	return FALSE;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) default(none) \
+    firstprivate(p, type, n, nb, P, shift, cnt)
+#endif
+    for (int b = 0; b < nb; b++) {
+	int *c = cnt + (size_t) b * P;
+	for (int i = PHASH_BLOCK_START(n, nb, b);
+	     i < PHASH_BLOCK_START(n, nb, b + 1); i++)
+	    c[phash_mix(phash_key(p, type, i)) >> shift]++;
+    }
+    /* partition starts, then block offsets within partitions; table
+       sizes are powers of 2 at least twice the partition sizes */
+    size_t tot = 0, pos = 0;
+    for (int q = 0; q < P; q++) {
+	pstart[q] = (int) pos;
+	ph->tstart[q] = (int) tot;
+	int m = 0;
+	for (int b = 0; b < nb; b++) {
+	    int c = cnt[(size_t) b * P + q];
+	    cnt[(size_t) b * P + q] = (int) pos;
+	    pos += c;
+	    m += c;
+	}
+	size_t M = 2;
+	while (M < 2 * (size_t) m) M *= 2;
+	tot += M;
+    }
+    pstart[P] = (int) pos;
+    ph->tstart[P] = (int) tot;
+    if (tot > INT_MAX || (ph->slab = malloc(tot * sizeof(int))) == NULL) {
+	free(cnt); free(pstart); free(idx); phash_free(ph);
+	return FALSE;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) default(none) \
+    firstprivate(p, type, n, nb, P, shift, cnt, idx)
+#endif
+    for (int b = 0; b < nb; b++) {
+	int *c = cnt + (size_t) b * P;
+	for (int i = PHASH_BLOCK_START(n, nb, b);
+	     i < PHASH_BLOCK_START(n, nb, b + 1); i++)
+	    idx[c[phash_mix(phash_key(p, type, i)) >> shift]++] = i;
+    }
+
+    int *tstart = ph->tstart, *slab = ph->slab;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic) default(none) \
+    firstprivate(p, type, P, pstart, tstart, slab, idx, from_last, dup)
+#endif
+    for (int q = 0; q < P; q++) {
+	int *h = slab + tstart[q];
+	uint64_t mask = (uint64_t) (tstart[q + 1] - tstart[q]) - 1;
+	for (uint64_t k = 0; k <= mask; k++) h[k] = NIL;
+	int m = pstart[q + 1] - pstart[q];
+	for (int j = 0; j < m; j++) {
+	    int i = idx[pstart[q] + (from_last ? m - 1 - j : j)];
+	    uint64_t key = phash_key(p, type, i);
+	    uint64_t k = phash_mix(key) & mask;
+	    int isdup = 0;
+	    while (h[k] != NIL) {
+		if (phash_key(p, type, h[k]) == key) {
+		    isdup = 1;
+		    break;
+		}
+		k = (k + 1) & mask;
+	    }
+	    if (!isdup) h[k] = i;
+	    if (dup) dup[i] = isdup;
+	}
+    }
+    free(cnt); free(pstart); free(idx);
+    return TRUE;
+}
+
+/* Look up the nx keys of xp in the tables built over tp. */
+static void phash_probe(phash *ph, const void *tp, const void *xp,
+			SEXPTYPE type, R_xlen_t nx, int *ans, int nomatch,
+			int nthreads)
+{
+    int shift = 64 - ph->pbits, *tstart = ph->tstart, *slab = ph->slab;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) default(none) \
+    firstprivate(tp, xp, type, nx, ans, nomatch, shift, tstart, slab)
+#endif
+    for (R_xlen_t i = 0; i < nx; i++) {
+	uint64_t key = phash_key(xp, type, i), hk = phash_mix(key);
+	int q = (int) (hk >> shift);
+	int *h = slab + tstart[q];
+	uint64_t mask = (uint64_t) (tstart[q + 1] - tstart[q]) - 1;
+	uint64_t k = hk & mask;
+	int val = nomatch;
+	while (h[k] != NIL) {
+	    if (phash_key(tp, type, h[k]) == key) {
+		val = h[k] + 1;
+		break;
+	    }
+	    k = (k + 1) & mask;
+	}
+	ans[i] = val;
+    }
+}
+
+/* duplicated() using parallel hashing; NULL if that does not apply */
+static SEXP phash_duplicated(SEXP x, Rboolean from_last)
+{
+    R_xlen_t n = XLENGTH(x);
+    int nthreads = phash_nthreads(n);
+    SEXPTYPE type = TYPEOF(x);
+    if (nthreads <= 1 || (type != INTSXP && type != REALSXP && type != STRSXP))
+	return NULL;
+    const void *p = DATAPTR_OR_NULL(x);
+    if (p == NULL || (type == STRSXP && !plainStrings(x)))
+	return NULL;
+    SEXP ans = PROTECT(allocVector(LGLSXP, n));
+    phash ph;
+    Rboolean ok = phash_build(&ph, p, type, (int) n, from_last,
+			      LOGICAL0(ans), nthreads);
+    phash_free(&ph);
+    UNPROTECT(1);
+    return ok ? ans : NULL;
+}
+
 static Rboolean duplicatedInit(SEXP x, HashData *d)
 {
     Rboolean stop = FALSE;
@@ -840,6 +1190,22 @@ static SEXP Duplicated(SEXP x, Rboolean from_last, int nmax)
     if(DUP_KNOWN_SORTED(x)) {
     	return sorted_Duplicated(x, from_last, nmax);
     }
+    Rboolean keep = !from_last && nmax == NA_INTEGER;
+    if (keep) {
+	HashData data = { 0 };
+	if (getHashIndex(x, &data)) {
+	    PROTECT(data.HashTable);
+	    PROTECT(ans = allocVector(LGLSXP, n));
+	    v = LOGICAL(ans);
+	    for (i = 0; i < n; i++)
+		v[i] = hashIndexFirst(x, i, &data) != i;
+	    UNPROTECT(2);
+	    return ans;
+	}
+    }
+    if (nmax == NA_INTEGER && !(keep && hashIndexable(x)) &&
+	(ans = phash_duplicated(x, from_last)) != NULL)
+	return ans;
     DUPLICATED_INIT;
 
     PROTECT(data.HashTable);
@@ -857,6 +1223,7 @@ static SEXP Duplicated(SEXP x, Rboolean from_last, int nmax)
 //	    if ((i+1) % NINTERRUPT == 0) R_CheckUserInterrupt();
 	    v[i] = isDuplicated(x, i, &data);
 	}
+    if (keep) putHashIndex(x, &data);
 
     UNPROTECT(2);
     return ans;
@@ -984,6 +1351,13 @@ R_xlen_t any_duplicated(SEXP x, Rboolean from_last)
     	return sorted_any_duplicated(x, from_last);
     }
 
+    HashData idata = { 0 };
+    if (!from_last && getHashIndex(x, &idata)) {
+	for (i = 0; i < n; i++)
+	    if(hashIndexFirst(x, i, &idata) != i) return i + 1;
+	return 0;
+    }
+
     DUPLICATED_INIT;
     PROTECT(data.HashTable);
 
@@ -1124,9 +1498,22 @@ attribute_hidden SEXP do_duplicated(SEXP call, SEXP op, SEXP args, SEXP env)
 	    error(_("'nmax' must be positive"));
     }
 
-    if(length(incomp) && /* S has FALSE to mean empty */
-       !(isLogical(incomp) && length(incomp) == 1 &&
-	 LOGICAL_ELT(incomp, 0) == 0)) {
+    /* x is known to have no duplicates, e.g. the result of unique() */
+    if (R_known_unique(x)) {
+	switch(PRIMVAL(op)) {
+	case 0:
+	    dup = allocVector(LGLSXP, n);
+	    memset(LOGICAL0(dup), 0, n * sizeof(int));
+	    return dup;
+	case 1: if (ATTRIB(x) == R_NilValue) return x; break;
+	case 2: return ScalarInteger(0);
+	}
+    }
+
+    Rboolean use_incomp = length(incomp) && /* S has FALSE to mean empty */
+	!(isLogical(incomp) && length(incomp) == 1 &&
+	  LOGICAL_ELT(incomp, 0) == 0);
+    if(use_incomp) {
 	if(PRIMVAL(op) == 2) {
 	    /* return R's 1-based index :*/
 	    R_xlen_t ind  = any_duplicated3(x, incomp, fL);
@@ -1204,6 +1591,176 @@ attribute_hidden SEXP do_duplicated(SEXP call, SEXP op, SEXP args, SEXP env)
     default:
 	UNIMPLEMENTED_TYPE("duplicated", x);
     }
+    /* record that the result has no duplicates, and keeps the order
+       and the absence of NAs of x; with incomparables it may have
+       duplicates */
+    if (use_incomp) {
+	UNPROTECT(2);
+	return ans;
+    }
+    int srt = UNKNOWN_SORTEDNESS;
+    if (TYPEOF(x) == INTSXP || TYPEOF(x) == REALSXP) {
+	int xsrt = TYPEOF(x) == INTSXP ? INTEGER_IS_SORTED(x) : REAL_IS_SORTED(x);
+	if (KNOWN_SORTED(xsrt)) srt = xsrt;
+    }
+    int no_na = FALSE;
+    switch(TYPEOF(x)) {
+    case INTSXP: no_na = INTEGER_NO_NA(x); break;
+    case REALSXP: no_na = REAL_NO_NA(x); break;
+    case STRSXP: no_na = STRING_NO_NA(x); break;
+    default: break;
+    }
+    ans = R_wrap_unique(ans, srt, no_na);
+    UNPROTECT(2);
+    return ans;
+}
+
+/* Grouping the rows of a list of columns, as .Internal(groupRows(x)).
+
+   The columns are atomic vectors of one length.  A row is hashed by
+   combining the hashes of its elements, using the same equivalences as
+   duplicated() on each column, and rows are compared column by column.
+   Returns the group of each row, numbered in order of first
+   occurrence, with attributes "first", the first row of each group,
+   and "sizes", the number of rows in each.  This serves duplicated()
+   and unique() on data frames and aggregate() without pasting keys.
+*/
+static R_INLINE unsigned int rowcolkey(SEXP c, R_xlen_t i, Rboolean useCache)
+{
+    switch(TYPEOF(c)) {
+    case LGLSXP:
+	return (unsigned int) LOGICAL_ELT(c, i);
+    case INTSXP:
+	return (unsigned int) INTEGER_ELT(c, i);
+    case REALSXP: {
+	double tmp = REAL_ELT(c, i);
+	if (tmp == 0.0) tmp = 0.0;
+	if (R_IsNA(tmp)) tmp = NA_REAL;
+	else if (R_IsNaN(tmp)) tmp = R_NaN;
+	union foo tmpu;
+	tmpu.d = tmp;
+	return tmpu.u[0] + tmpu.u[1];
+    }
+    case CPLXSXP: {
+	Rcomplex tmp = unify_complex_na(COMPLEX_ELT(c, i));
+	union foo tmpu;
+	tmpu.d = tmp.r;
+	unsigned int u = tmpu.u[0] ^ tmpu.u[1];
+	tmpu.d = tmp.i;
+	return u ^ tmpu.u[0] ^ tmpu.u[1];
+    }
+    case STRSXP: {
+	SEXP xi = STRING_ELT(c, i);
+	if (useCache)
+	    return PTRHASH(xi);
+	int noTrans = (IS_BYTES(xi) || IS_ASCII(xi)) ? TRUE : FALSE;
+	const void *vmax = vmaxget();
+	const char *p = noTrans ? CHAR(xi) : translateCharUTF8(xi);
+	unsigned int k = 0;
+	while (*p++)
+	    k = 11 * k + (unsigned int) *p;
+	vmaxset(vmax);
+	return k;
+    }
+    case RAWSXP:
+	return (unsigned int) RAW_ELT(c, i);
+    default:
+	return 0;
+    }
+}
+
+static hlen rowhash(SEXP x, R_xlen_t indx, HashData *d)
+{
+    unsigned int u = 0;
+    for (int j = 0; j < LENGTH(x); j++)
+	u = (u ^ rowcolkey(VECTOR_ELT(x, j), indx, d->useCache)) * 1000003U;
+    return scatter(u, d);
+}
+
+static int rowequal(SEXP x, R_xlen_t i, SEXP y, R_xlen_t j)
+{
+    if (i < 0 || j < 0) return 0;
+    for (int k = 0; k < LENGTH(x); k++) {
+	SEXP c = VECTOR_ELT(x, k);
+	int eq;
+	switch(TYPEOF(c)) {
+	case LGLSXP: eq = lequal(c, i, c, j); break;
+	case INTSXP: eq = iequal(c, i, c, j); break;
+	case REALSXP: eq = requal(c, i, c, j); break;
+	case CPLXSXP: eq = cequal(c, i, c, j); break;
+	case STRSXP: eq = sequal(c, i, c, j); break;
+	case RAWSXP: eq = rawequal(c, i, c, j); break;
+	default: eq = 0;
+	}
+	if (!eq) return 0;
+    }
+    return 1;
+}
+
+attribute_hidden SEXP do_grouprows(SEXP call, SEXP op, SEXP args, SEXP env)
+{
+    checkArity(op, args);
+    SEXP x = CAR(args);
+    if (TYPEOF(x) != VECSXP)
+	error(_("'%s' must be a list"), "x");
+    int nc = LENGTH(x);
+    R_xlen_t n = nc > 0 ? XLENGTH(VECTOR_ELT(x, 0)) : 0;
+    Rboolean useCache = TRUE;
+    for (int j = 0; j < nc; j++) {
+	SEXP c = VECTOR_ELT(x, j);
+	switch(TYPEOF(c)) {
+	case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case RAWSXP:
+	    break;
+	case STRSXP:
+	    if (useCache && !plainStrings(c)) useCache = FALSE;
+	    break;
+	default:
+	    error(_("all columns must be atomic vectors"));
+	}
+	if (XLENGTH(c) != n)
+	    error(_("all columns must have the same length"));
+    }
+    if (n > INT_MAX)
+	error(_("long vectors not supported yet: %s:%d"), __FILE__, __LINE__);
+
+    HashData data = { 0 };
+    MKsetup(n, &data, NA_INTEGER);
+    data.hash = rowhash;
+    data.equal = rowequal;
+    data.useCache = useCache;
+#ifdef LONG_VECTOR_SUPPORT
+    data.isLong = FALSE;
+#endif
+    data.HashTable = allocVector(INTSXP, (R_xlen_t) data.M);
+    PROTECT(data.HashTable);
+    int *h = HTDATA_INT(&data);
+    for (hlen k = 0; k < data.M; k++) h[k] = NIL;
+
+    SEXP ans = PROTECT(allocVector(INTSXP, n));
+    int *g = INTEGER0(ans);
+    /* first rows and sizes, the latter counted in g until the end */
+    int *first = (int *) R_alloc(n > 0 ? n : 1, sizeof(int));
+    int *size = (int *) R_alloc(n > 0 ? n : 1, sizeof(int));
+    int ng = 0;
+    for (int i = 0; i < n; i++) {
+	hlen k = rowhash(x, i, &data);
+	while (h[k] != NIL && !rowequal(x, h[k], x, i))
+	    k = (k + 1) % data.M;
+	if (h[k] == NIL) {
+	    h[k] = i;
+	    first[ng] = i + 1;
+	    size[ng] = 0;
+	    g[i] = ++ng;
+	}
+	else g[i] = g[h[k]];
+	size[g[i] - 1]++;
+    }
+    SEXP sfirst = allocVector(INTSXP, ng);
+    setAttrib(ans, install("first"), sfirst);
+    memcpy(INTEGER0(sfirst), first, ng * sizeof(int));
+    SEXP ssize = allocVector(INTSXP, ng);
+    setAttrib(ans, install("sizes"), ssize);
+    memcpy(INTEGER0(ssize), size, ng * sizeof(int));
     UNPROTECT(2);
     return ans;
 }
@@ -1278,6 +1835,45 @@ static SEXP HashLookup(SEXP table, SEXP x, HashData *d)
     return ans;
 }
 
+/* Name indices.
+
+   Looking up one name in the long names of a vector by x["a"], [[ and
+   $ uses the kept hash index of the names, which is built by the first
+   lookup.  A replacement of the names is a new vector, and the names
+   are duplicated before being modified, so the index is that of the
+   current names.  The index is only used for names and a name all
+   cached, native and not bytes, and then pointer equality of the names
+   is equality of their translations.
+
+   Returns FALSE if the index cannot be used, and otherwise sets *indx
+   to the position (from 0) of the first name equal to 's', or -1.
+*/
+attribute_hidden Rboolean
+R_lookupNameIndex(SEXP names, SEXP s, R_xlen_t *indx)
+{
+    if (TYPEOF(names) != STRSXP || !hashIndexable(names) ||
+	s == NA_STRING || !CHAR(s)[0] ||
+	IS_BYTES(s) || ENC_KNOWN(s) || !IS_CACHED(s))
+	return FALSE;
+
+    HashData data = { 0 };
+    if (!getHashIndex(names, &data)) {
+	if (!plainStrings(names))
+	    return FALSE;
+	HashTableSetup(names, &data, NA_INTEGER);
+	PROTECT(data.HashTable);
+	DoHashing(names, &data);
+	putHashIndex(names, &data);
+	UNPROTECT(1);
+    }
+    PROTECT(data.HashTable);
+    SEXP x = PROTECT(ScalarString(s));
+    data.nomatch = 0;
+    *indx = sLookup(names, x, 0, &data) - 1;
+    UNPROTECT(2);
+    return TRUE;
+}
+
 static SEXP match_transform(SEXP s, SEXP env)
 {
     if(OBJECT(s)) {
@@ -1328,6 +1924,141 @@ static SEXP asUTF8(SEXP x)
 	return x;
 }
     
+/* match() against a table known to be sorted in increasing order, as
+   recorded by sort() or an ALTREP class.  Any NAs of the table are in
+   a block at one end, located by bisection, and the rest is searched
+   by bisection for each element of x, or merged with x when that is
+   known to be sorted increasingly as well.  Bisection is only used
+   when it beats hashing the table.  Returns NULL if this does not
+   apply. */
+#define SORTED_MATCH_MIN_N 1000
+
+#define SMATCH_BISECT(T, lo, hi, v, res) do {			\
+	R_xlen_t l_ = lo, h_ = hi;					\
+	while (l_ < h_) {						\
+	    R_xlen_t m_ = l_ + (h_ - l_) / 2;				\
+	    if (T(m_) < (v)) l_ = m_ + 1; else h_ = m_;			\
+	}								\
+	res = l_;							\
+    } while (0)
+
+/* first index of a NA block of the table, or one past its end if the
+   block comes first */
+#define SMATCH_NA_BLOCK(T, ISNA_T, nt, na1st, res) do {			\
+	R_xlen_t l_ = 0, h_ = nt;					\
+	while (l_ < h_) {						\
+	    R_xlen_t m_ = l_ + (h_ - l_) / 2;				\
+	    if (ISNA_T(T(m_)) == (na1st)) l_ = m_ + 1; else h_ = m_;	\
+	}								\
+	res = l_;							\
+    } while (0)
+
+#define SMATCH_LOOP(XV, T, lo, hi) do {					\
+	for (R_xlen_t i = 0, j = lo; i < nx; i++) {			\
+	    R_xlen_t k;							\
+	    if (merge) {						\
+		while (j < hi && T(j) < XV(i)) j++;			\
+		k = j;							\
+	    }								\
+	    else SMATCH_BISECT(T, lo, hi, XV(i), k);			\
+	    pa[i] = (k < hi && T(k) == XV(i)) ? (int) k + 1 : nmatch;	\
+	}								\
+    } while (0)
+
+static SEXP sorted_match(SEXP x, SEXP table, int nmatch)
+{
+    SEXPTYPE type = TYPEOF(x);
+    if (type != INTSXP && type != REALSXP)
+	return NULL;
+    R_xlen_t nx = XLENGTH(x), nt = XLENGTH(table);
+    if (nt < SORTED_MATCH_MIN_N || nt > INT_MAX)
+	return NULL;
+    int tsrt, xsrt;
+    if (type == INTSXP) {
+	tsrt = INTEGER_IS_SORTED(table);
+	xsrt = INTEGER_IS_SORTED(x);
+    }
+    else {
+	tsrt = REAL_IS_SORTED(table);
+	xsrt = REAL_IS_SORTED(x);
+    }
+    if (! KNOWN_INCR(tsrt))
+	return NULL;
+    /* bisection costs about log2(nt) per element of x, hashing the
+       table a few times nt */
+    double lg = log2((double) nt);
+    Rboolean merge = KNOWN_INCR(xsrt) && nx * lg >= nt;
+    if (! merge && nx * lg >= 3.0 * nt)
+	return NULL;
+
+    SEXP ans = PROTECT(allocVector(INTSXP, nx));
+    int *pa = INTEGER0(ans);
+    Rboolean na1st = KNOWN_NA_1ST(tsrt);
+    R_xlen_t lo, hi, nb;
+
+    if (type == INTSXP) {
+	const int *t = (const int *) DATAPTR_OR_NULL(table);
+	const int *px = (const int *) DATAPTR_OR_NULL(x);
+#define TP(k) t[k]
+#define TE(k) INTEGER_ELT(table, k)
+#define XP(i) px[i]
+#define XE(i) INTEGER_ELT(x, i)
+#define INT_ISNA(v) ((v) == NA_INTEGER)
+	if (t) SMATCH_NA_BLOCK(TP, INT_ISNA, nt, na1st, nb);
+	else SMATCH_NA_BLOCK(TE, INT_ISNA, nt, na1st, nb);
+	if (na1st) { lo = nb; hi = nt; } else { lo = 0; hi = nb; }
+	/* the non-NA part is searched; NA matches the first table NA */
+	int xna = nmatch;
+	if (na1st ? lo > 0 : hi < nt) xna = na1st ? 1 : (int) hi + 1;
+	if (t && px) SMATCH_LOOP(XP, TP, lo, hi);
+	else if (t) SMATCH_LOOP(XE, TP, lo, hi);
+	else if (px) SMATCH_LOOP(XP, TE, lo, hi);
+	else SMATCH_LOOP(XE, TE, lo, hi);
+	for (R_xlen_t i = 0; i < nx; i++)
+	    if (INTEGER_ELT(x, i) == NA_INTEGER) pa[i] = xna;
+#undef TP
+#undef TE
+#undef XP
+#undef XE
+#undef INT_ISNA
+    }
+    else {
+	const double *t = (const double *) DATAPTR_OR_NULL(table);
+	const double *px = (const double *) DATAPTR_OR_NULL(x);
+#define TP(k) t[k]
+#define TE(k) REAL_ELT(table, k)
+#define XP(i) px[i]
+#define XE(i) REAL_ELT(x, i)
+	if (t) SMATCH_NA_BLOCK(TP, ISNAN, nt, na1st, nb);
+	else SMATCH_NA_BLOCK(TE, ISNAN, nt, na1st, nb);
+	if (na1st) { lo = nb; hi = nt; } else { lo = 0; hi = nb; }
+	/* all NAs match the first NA, and all other NaNs the first
+	   such NaN, of the block */
+	int xna = nmatch, xnan = nmatch;
+	for (R_xlen_t k = na1st ? 0 : hi; k < (na1st ? lo : nt); k++) {
+	    double v = REAL_ELT(table, k);
+	    if (R_IsNA(v)) { if (xna == nmatch) xna = (int) k + 1; }
+	    else if (xnan == nmatch) xnan = (int) k + 1;
+	    if (xna != nmatch && xnan != nmatch) break;
+	}
+	/* NaN compares false, so these leave NaN elements unmatched */
+	if (t && px) SMATCH_LOOP(XP, TP, lo, hi);
+	else if (t) SMATCH_LOOP(XE, TP, lo, hi);
+	else if (px) SMATCH_LOOP(XP, TE, lo, hi);
+	else SMATCH_LOOP(XE, TE, lo, hi);
+	for (R_xlen_t i = 0; i < nx; i++) {
+	    double v = REAL_ELT(x, i);
+	    if (ISNAN(v)) pa[i] = R_IsNA(v) ? xna : xnan;
+	}
+#undef TP
+#undef TE
+#undef XP
+#undef XE
+    }
+    UNPROTECT(1);
+    return ans;
+}
+
 // workhorse of R's match() and hence also  " ix %in% itable "
 SEXP match5(SEXP itable, SEXP ix, int nmatch, SEXP incomp, SEXP env)
 {
@@ -1345,16 +2076,38 @@ SEXP match5(SEXP itable, SEXP ix, int nmatch, SEXP incomp, SEXP env)
 
     int nprot = 0;
     SEXP x     = PROTECT(match_transform(ix,     env)); nprot++;
-    SEXP table = PROTECT(match_transform(itable, env)); nprot++;
-    /* or should we use PROTECT_WITH_INDEX and REPROTECT below ? */
 
     SEXPTYPE type;
     /* Coerce to a common type; type == NILSXP is ok here.
-     * Note that above we coerce factors and "POSIXlt", only to character.
+     * Note that below we coerce factors and "POSIXlt", only to character.
      * Hence, coerce to character or to `higher' type
      * (given that we have "Vector" or NULL) */
-    if(TYPEOF(x) >= STRSXP || TYPEOF(table) >= STRSXP) type = STRSXP;
-    else type = TYPEOF(x) < TYPEOF(table) ? TYPEOF(table) : TYPEOF(x);
+#define MATCH_TYPE(x, table)						\
+    ((TYPEOF(x) >= STRSXP || TYPEOF(table) >= STRSXP) ? STRSXP :	\
+     (TYPEOF(x) < TYPEOF(table) ? TYPEOF(table) : TYPEOF(x)))
+
+    /* a kept hash index of itable is used as is */
+    Rboolean keyed = R_HashIndex && !incomp && !OBJECT(itable) &&
+	MATCH_TYPE(x, itable) == TYPEOF(itable);
+    if (keyed && n > 1) {
+	HashData data = { 0 };
+	SEXP cx = PROTECT(coerceVector(x, TYPEOF(itable)));
+	if ((TYPEOF(cx) != STRSXP || plainStrings(cx)) &&
+	    getHashIndex(itable, &data)) {
+	    data.nomatch = nmatch;
+	    PROTECT(data.HashTable);
+	    ans = HashLookup(itable, cx, &data);
+	    UNPROTECT(nprot + 2);
+	    return ans;
+	}
+	UNPROTECT(1);
+    }
+
+    /* a keyed itable is hashed itself, so its table can be kept */
+    SEXP table = PROTECT(keyed ? itable : match_transform(itable, env)); nprot++;
+    /* or should we use PROTECT_WITH_INDEX and REPROTECT below ? */
+    type = MATCH_TYPE(x, table);
+#undef MATCH_TYPE
     PROTECT(x	  = coerceVector(x,	type)); nprot++;
     PROTECT(table = coerceVector(table, type)); nprot++;
 
@@ -1417,16 +2170,17 @@ SEXP match5(SEXP itable, SEXP ix, int nmatch, SEXP incomp, SEXP env)
       }
       PROTECT(ans = ScalarInteger(val)); nprot++;
     }
+    else if (!incomp && (ans = sorted_match(x, table, nmatch)) != NULL) {
+	PROTECT(ans); nprot++;
+    }
     else { // regular case
 	HashData data = { 0 };
 	if (incomp) { PROTECT(incomp = coerceVector(incomp, type)); nprot++; }
 	data.nomatch = nmatch;
-	HashTableSetup(table, &data, NA_INTEGER);
-	PROTECT(data.HashTable); nprot++;
+	Rboolean useBytes = FALSE;
+	Rboolean useUTF8 = FALSE;
+	Rboolean useCache = TRUE;
 	if(type == STRSXP) {
-	    Rboolean useBytes = FALSE;
-	    Rboolean useUTF8 = FALSE;
-	    Rboolean useCache = TRUE;
 	    for(R_xlen_t i = 0; i < xlength(x); i++) {
 		SEXP s = STRING_ELT(x, i);
 		if(IS_BYTES(s)) {
@@ -1459,6 +2213,29 @@ SEXP match5(SEXP itable, SEXP ix, int nmatch, SEXP incomp, SEXP env)
 		    }
 		}
 	    }
+	}
+	/* parallel hashing, unless a table is to be kept */
+	int nthreads = phash_nthreads(XLENGTH(table));
+	if (!incomp && nthreads > 1 &&
+	    !(keyed && hashIndexable(itable)) &&
+	    (type == INTSXP || type == REALSXP ||
+	     (type == STRSXP && !useBytes && !useUTF8 && useCache))) {
+	    const void *tp = DATAPTR_OR_NULL(table), *xp = DATAPTR_OR_NULL(x);
+	    phash ph;
+	    if (tp && xp &&
+		phash_build(&ph, tp, type, LENGTH(table), FALSE, NULL,
+			    nthreads)) {
+		PROTECT(ans = allocVector(INTSXP, n)); nprot++;
+		phash_probe(&ph, tp, xp, type, n, INTEGER0(ans), nmatch,
+			    nthreads);
+		phash_free(&ph);
+		UNPROTECT(nprot);
+		return ans;
+	    }
+	}
+	HashTableSetup(table, &data, NA_INTEGER);
+	PROTECT(data.HashTable); nprot++;
+	if(type == STRSXP) {
 	    if(useUTF8) {
 		x = PROTECT(asUTF8(x)); nprot++;
 		table = PROTECT(asUTF8(table)); nprot++;
@@ -1468,6 +2245,8 @@ SEXP match5(SEXP itable, SEXP ix, int nmatch, SEXP incomp, SEXP env)
 	}
 	DoHashing(table, &data);
 	if (incomp) UndoHashing(incomp, table, &data);
+	else if (keyed && table == itable) /* not converted to UTF-8 */
+	    putHashIndex(table, &data);
 	ans = HashLookup(table, x, &data);
     }
     UNPROTECT(nprot);
@@ -2100,6 +2879,324 @@ attribute_hidden SEXP do_rowsum(SEXP call, SEXP op, SEXP args, SEXP env)
 		      CAD4R(args));
 }
 
+/* Grouped reductions for .groupReduce(x, g, ngroups, FUN, na.rm).
+
+   Each column of 'x' (logical, integer or double) is reduced over the
+   groups given by 'g', which holds group numbers in 1:ngroups or NA for
+   elements to be left out.  Each group's result is the same as that of
+   the R function applied to the elements of the group in order:
+   sums and means accumulate in long double and means are refined by a
+   second pass, as sum() and mean() do with options(summation = "ldouble").
+   Groups without elements give NA for min, max, first and last.
+
+   With several threads the groups are split into ranges, each thread
+   scanning all of 'g' and updating only the groups in its range, so
+   the results do not depend on the number of threads and the working
+   set of each thread is smaller when there are many groups. */
+
+#define GRED_THREADS_MIN_N 100000
+
+enum { GRED_SUM, GRED_MEAN, GRED_MIN, GRED_MAX, GRED_COUNT, GRED_FIRST,
+       GRED_LAST };
+
+typedef struct {
+    int fun;			/* GRED_* */
+    SEXPTYPE type;		/* of 'x': LGLSXP, INTSXP or REALSXP */
+    const void *x;		/* the column */
+    const int *g;
+    int n;
+    Rboolean narm;
+    LDOUBLE *s, *t;		/* sums for GRED_SUM and GRED_MEAN of doubles */
+    int64_t *is;		/* integer sums */
+    int *cnt;			/* counts for GRED_MEAN */
+    char *st;			/* 0: no value yet, 1: value, 2: NA */
+    void *ans;			/* the result column */
+} gred_work;
+
+/* BODY is run for the elements xi of x whose 0-based group k is in
+   [glo, ghi); NA_INTEGER is less than any group number. */
+#define GRED_LOOP(XTYPE, BODY) do {				\
+	const XTYPE *x = (const XTYPE *) w->x;			\
+	for (int i = 0; i < n; i++) {				\
+	    int gi = g[i];					\
+	    if (gi > glo && gi <= ghi) {			\
+		int k = gi - 1;					\
+		XTYPE xi = x[i];				\
+		BODY;						\
+	    }							\
+	}							\
+    } while (0)
+
+static void gred_range(const gred_work *w, int glo, int ghi)
+{
+    const int *g = w->g;
+    int n = w->n;
+    Rboolean narm = w->narm, max = w->fun == GRED_MAX;
+    char *st = w->st;
+    for (int k = glo; k < ghi; k++) st[k] = 0;
+
+    switch(w->fun) {
+    case GRED_SUM:
+	if (w->type == REALSXP) {
+	    LDOUBLE *s = w->s;
+	    double *ans = w->ans;
+	    for (int k = glo; k < ghi; k++) s[k] = 0.0;
+	    GRED_LOOP(double, if (!narm || !ISNAN(xi)) s[k] += xi);
+	    for (int k = glo; k < ghi; k++)
+		ans[k] = s[k] > DBL_MAX ? R_PosInf :
+		    (s[k] < -DBL_MAX ? R_NegInf : (double) s[k]);
+	}
+	else {
+	    /* exact for groups of fewer than 2^32 elements */
+	    int64_t *s = w->is;
+	    double *ans = w->ans;
+	    for (int k = glo; k < ghi; k++) s[k] = 0;
+	    GRED_LOOP(int, if (xi != NA_INTEGER) s[k] += xi;
+		      else if (!narm) st[k] = 2);
+	    for (int k = glo; k < ghi; k++)
+		ans[k] = st[k] == 2 ? NA_REAL : (double) s[k];
+	}
+	break;
+    case GRED_MEAN:
+    {
+	LDOUBLE *s = w->s, *t = w->t;
+	int *cnt = w->cnt;
+	double *ans = w->ans;
+	for (int k = glo; k < ghi; k++) {
+	    s[k] = t[k] = 0.0;
+	    cnt[k] = 0;
+	}
+	if (w->type != REALSXP) {
+	    GRED_LOOP(int, if (xi != NA_INTEGER) { s[k] += xi; cnt[k]++; }
+		      else if (!narm) st[k] = 2);
+	    for (int k = glo; k < ghi; k++)
+		ans[k] = st[k] == 2 ? NA_REAL : (double) (s[k] / cnt[k]);
+	    break;
+	}
+	/* as real_mean() in summary.c: st is 1 if the first sum is
+	   finite, 2 if it has to be redone with smaller terms */
+	Rboolean redo = FALSE;
+	GRED_LOOP(double, if (!narm || !ISNAN(xi)) { s[k] += xi; cnt[k]++; });
+	for (int k = glo; k < ghi; k++) {
+	    if (R_FINITE((double) s[k])) {
+		s[k] /= cnt[k];
+		st[k] = 1;
+	    }
+	    else {
+		s[k] = 0.0;
+		st[k] = 2;
+		redo = TRUE;
+	    }
+	}
+	if (redo)
+	    GRED_LOOP(double, if (st[k] == 2 && (!narm || !ISNAN(xi)))
+			  s[k] += xi / cnt[k]);
+	for (int k = glo; k < ghi; k++)
+	    if (!R_FINITE((double) s[k])) st[k] = 0;
+	GRED_LOOP(double, if (st[k] && (!narm || !ISNAN(xi)))
+		      t[k] += st[k] == 1 ? xi - s[k] : (xi - s[k]) / cnt[k]);
+	for (int k = glo; k < ghi; k++)
+	    ans[k] = (double) (st[k] == 1 ? s[k] + t[k] / cnt[k] : s[k] + t[k]);
+	break;
+    }
+    case GRED_MIN:
+    case GRED_MAX:
+    {
+	/* empty groups are finished off by the caller */
+	double *ans = w->ans;
+	for (int k = glo; k < ghi; k++) ans[k] = 0.0;
+	if (w->type == REALSXP)
+	    GRED_LOOP(double,
+		      if (ISNAN(xi)) {
+			  if (!narm) {
+			      if (!ISNA(ans[k])) ans[k] = xi; /* NA trumps NaN */
+			      st[k] = 1;
+			  }
+		      }
+		      else if (!st[k] || (max ? xi > ans[k] : xi < ans[k])) {
+			  ans[k] = xi;
+			  st[k] = 1;
+		      });
+	else {
+	    GRED_LOOP(int,
+		      if (st[k] == 2) continue;
+		      if (xi == NA_INTEGER) {
+			  if (!narm) st[k] = 2;
+		      }
+		      else if (!st[k] || (max ? xi > ans[k] : xi < ans[k])) {
+			  ans[k] = xi;
+			  st[k] = 1;
+		      });
+	    for (int k = glo; k < ghi; k++)
+		if (st[k] == 2) ans[k] = NA_REAL;
+	}
+	break;
+    }
+    case GRED_COUNT:
+    {
+	int *ans = w->ans;
+	for (int k = glo; k < ghi; k++) ans[k] = 0;
+	if (w->type == REALSXP)
+	    GRED_LOOP(double, if (!narm || !ISNAN(xi)) ans[k]++);
+	else
+	    GRED_LOOP(int, if (!narm || xi != NA_INTEGER) ans[k]++);
+	break;
+    }
+    case GRED_FIRST:
+    case GRED_LAST:
+    {
+	Rboolean last = w->fun == GRED_LAST;
+	if (w->type == REALSXP) {
+	    double *ans = w->ans;
+	    GRED_LOOP(double, if ((last || !st[k]) && (!narm || !ISNAN(xi))) {
+		    ans[k] = xi;
+		    st[k] = 1;
+		});
+	    for (int k = glo; k < ghi; k++)
+		if (!st[k]) ans[k] = NA_REAL;
+	}
+	else {
+	    int *ans = w->ans;
+	    GRED_LOOP(int, if ((last || !st[k]) && (!narm || xi != NA_INTEGER)) {
+		    ans[k] = xi;
+		    st[k] = 1;
+		});
+	    for (int k = glo; k < ghi; k++)
+		if (!st[k]) ans[k] = NA_INTEGER;
+	}
+	break;
+    }
+    }
+}
+
+static int gred_nthreads(int n, int ng)
+{
+#ifdef _OPENMP
+    if (n >= GRED_THREADS_MIN_N && R_num_math_threads > 1 && ng > 1)
+	return R_num_math_threads < ng ? R_num_math_threads : ng;
+#endif
+    return 1;
+}
+
+attribute_hidden SEXP do_groupreduce(SEXP call, SEXP op, SEXP args, SEXP env)
+{
+    static const char *funs[] =
+	{ "sum", "mean", "min", "max", "count", "first", "last", NULL };
+
+    checkArity(op, args);
+    SEXP x = CAR(args), sg = CADR(args), sfun = CADDDR(args);
+    int ng = asInteger(CADDR(args)), narm = asLogical(CAD4R(args));
+    SEXPTYPE type = TYPEOF(x);
+    if (type != LGLSXP && type != INTSXP && type != REALSXP)
+	error(_("invalid '%s' argument"), "x");
+    if (TYPEOF(sg) != INTSXP)
+	error(_("invalid '%s' argument"), "g");
+    if (ng == NA_INTEGER || ng < 0)
+	error(_("invalid '%s' argument"), "ngroups");
+    int fun = -1;
+    if (isString(sfun) && LENGTH(sfun) == 1)
+	for (int f = 0; funs[f]; f++)
+	    if (!strcmp(CHAR(STRING_ELT(sfun, 0)), funs[f])) fun = f;
+    if (fun < 0)
+	error(_("invalid '%s' argument"), "FUN");
+    if (narm == NA_LOGICAL)
+	error(_("invalid '%s' argument"), "na.rm");
+    R_xlen_t nx = XLENGTH(sg);
+    if (nx > INT_MAX)
+	error(_("long vectors not supported yet: %s:%d"), __FILE__, __LINE__);
+    int n = (int) nx, p = isMatrix(x) ? ncols(x) : 1;
+    if ((isMatrix(x) ? nrows(x) : XLENGTH(x)) != n)
+	error(_("arguments must have same length"));
+
+    const int *g = INTEGER_RO(sg);
+    SEXP ssize = PROTECT(allocVector(INTSXP, ng));
+    int *size = INTEGER0(ssize);
+    for (int k = 0; k < ng; k++) size[k] = 0;
+    for (int i = 0; i < n; i++) {
+	if (g[i] == NA_INTEGER) continue;
+	if (g[i] < 1 || g[i] > ng)
+	    error(_("invalid '%s' argument"), "g");
+	size[g[i] - 1]++;
+    }
+
+    /* sums, means, minima and maxima are computed as doubles and
+       converted back below for integer 'x' */
+    SEXPTYPE rtype = fun == GRED_COUNT ? INTSXP :
+	(fun == GRED_FIRST || fun == GRED_LAST) ? type : REALSXP;
+    SEXP ans = PROTECT(isMatrix(x) ? allocMatrix(rtype, ng, p) :
+		       allocVector(rtype, ng));
+    gred_work w = { 0 };
+    w.fun = fun;
+    w.type = type;
+    w.g = g;
+    w.n = n;
+    w.narm = narm;
+    w.st = R_alloc(ng > 0 ? ng : 1, sizeof(char));
+    if (fun == GRED_SUM || fun == GRED_MEAN) {
+	if (type == REALSXP || fun == GRED_MEAN)
+	    w.s = (LDOUBLE *) R_alloc(ng > 0 ? ng : 1, sizeof(LDOUBLE));
+	else
+	    w.is = (int64_t *) R_alloc(ng > 0 ? ng : 1, sizeof(int64_t));
+	if (fun == GRED_MEAN) {
+	    w.t = (LDOUBLE *) R_alloc(ng > 0 ? ng : 1, sizeof(LDOUBLE));
+	    w.cnt = (int *) R_alloc(ng > 0 ? ng : 1, sizeof(int));
+	}
+    }
+
+    int nthreads = gred_nthreads(n, ng), nempty = 0;
+    for (int j = 0; j < p; j++) {
+	R_xlen_t off = (R_xlen_t) j * n, roff = (R_xlen_t) j * ng;
+	if (type == REALSXP) w.x = REAL_RO(x) + off;
+	else w.x = (type == INTSXP ? INTEGER_RO(x) : LOGICAL_RO(x)) + off;
+	if (rtype == REALSXP) w.ans = REAL0(ans) + roff;
+	else w.ans = (rtype == INTSXP ? INTEGER0(ans) : LOGICAL0(ans)) + roff;
+	if (nthreads > 1) {
+	    const gred_work *pw = &w;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static) \
+    default(none) firstprivate(pw, ng, nthreads)
+#endif
+	    for (int t = 0; t < nthreads; t++)
+		gred_range(pw, (int) ((double) ng * t / nthreads),
+			   (int) ((double) ng * (t + 1) / nthreads));
+	}
+	else gred_range(&w, 0, ng);
+
+	if (fun == GRED_MIN || fun == GRED_MAX) {
+	    double *a = w.ans, inf = fun == GRED_MIN ? R_PosInf : R_NegInf;
+	    for (int k = 0; k < ng; k++)
+		if (!w.st[k]) {
+		    if (size[k] > 0) {
+			a[k] = inf;
+			nempty++;
+		    }
+		    else a[k] = NA_REAL;
+		}
+	}
+    }
+    if (nempty)
+	warningcall(call, fun == GRED_MIN ?
+		    _("no non-missing arguments to min; returning Inf") :
+		    _("no non-missing arguments to max; returning -Inf"));
+
+    if (type != REALSXP &&
+	(fun == GRED_SUM || fun == GRED_MIN || fun == GRED_MAX)) {
+	/* integer results unless a value is out of range (or infinite) */
+	const double *a = REAL_RO(ans);
+	R_xlen_t len = XLENGTH(ans), i;
+	for (i = 0; i < len; i++)
+	    if (!ISNAN(a[i]) && (a[i] > INT_MAX || a[i] < -INT_MAX)) break;
+	if (i == len) {
+	    ans = coerceVector(ans, INTSXP);
+	    UNPROTECT(1);
+	    PROTECT(ans);
+	}
+    }
+    setAttrib(ans, install("sizes"), ssize);
+    UNPROTECT(2); /* ssize, ans */
+    return ans;
+}
+
 
 /* returns 1-based duplicate no */
 static int isDuplicated2(SEXP x, int indx, HashData *d)
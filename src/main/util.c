@@ -2227,6 +2227,47 @@ attribute_hidden SEXP do_enc2(SEXP call, SEXP op, SEXP args, SEXP env)
     return ans;
 }
 
+/* Collation keys, used when options(collation.keys) is true.
+
+   A key is a RAWSXP whose bytes compare (as by memcmp, the shorter key
+   first on a tie) in the same order as the strings collate.  Keys are
+   computed by the collator in use (ICU or strxfrm) and cached per
+   CHARSXP, so that repeated comparisons of the same strings need not
+   collate them again.  The cache is cleared whenever the collation
+   may have changed.  The C and "ASCII" collations compare bytes, so
+   have no keys.
+*/
+
+#if defined(USE_ICU) || !defined(Win32)
+# include <locale.h>
+static SEXP collationKeyBytes(const char *s, size_t len)
+{
+    SEXP key = allocVector(RAWSXP, len);
+    memcpy(RAW(key), s, len);
+    return key;
+}
+
+static Rboolean collationIsC(void)
+{
+    const char *p = setlocale(LC_COLLATE, NULL);
+    return !p || streql(p, "C") || streql(p, "POSIX");
+}
+
+/* NULL if the string cannot be transformed */
+static SEXP collationKeyXfrm(const char *s)
+{
+    size_t size = 2 * strlen(s) + 16, need;
+    char *buf = R_alloc(size, 1);
+    need = strxfrm(buf, s, size);
+    if (need >= size) {
+	buf = R_alloc(need + 1, 1);
+	need = strxfrm(buf, s, need + 1);
+    }
+    if (errno) return NULL;
+    return collationKeyBytes(buf, need);
+}
+#endif
+
 #ifdef USE_ICU
 # include <locale.h>
 #ifdef USE_ICU_APPLE
@@ -2330,6 +2371,7 @@ attribute_hidden void resetICUcollator(Rboolean disable)
     if (collator) ucol_close(collator);
     collator = NULL;
     collationLocaleSet = disable ? 1 : 0;
+    R_resetCollationKeys();
 }
 
 static const struct {
@@ -2403,6 +2445,7 @@ attribute_hidden SEXP do_ICUset(SEXP call, SEXP op, SEXP args, SEXP rho)
 	if (!isString(x) || LENGTH(x) != 1)
 	    error(_("invalid '%s' argument"), this);
 	s = CHAR(STRING_ELT(x, 0));
+	R_resetCollationKeys();
 	if (streql(this, "locale")) {
 	    if (collator) {
 		ucol_close(collator);
@@ -2480,10 +2523,7 @@ attribute_hidden SEXP do_ICUget(SEXP call, SEXP op, SEXP args, SEXP rho)
     return mkString(ans);
 }
 
-/* Caller has to manage the R_alloc stack */
-/* NB: strings can have equal collation weight without being identical */
-attribute_hidden
-int Scollate(SEXP a, SEXP b)
+static void initCollator(void)
 {
     if (!collationLocaleSet) {
 	int errsv = errno;      /* OSX may set errno in the operations below. */
@@ -2531,6 +2571,14 @@ int Scollate(SEXP a, SEXP b)
 	}
 	errno = errsv;
     }
+}
+
+/* Caller has to manage the R_alloc stack */
+/* NB: strings can have equal collation weight without being identical */
+attribute_hidden
+int Scollate(SEXP a, SEXP b)
+{
+    initCollator();
     // translation may use escapes, but that is OK here
     if (collator == NULL)
 	return collationLocaleSet == 2 ?
@@ -2548,6 +2596,51 @@ int Scollate(SEXP a, SEXP b)
     return result;
 }
 
+/* Keys do not pay off for byte-order collation, and cannot be
+   computed with the ICU headers we have on macOS. */
+static Rboolean collationHasKeys(void)
+{
+    initCollator();
+    if (collator == NULL)
+	return collationLocaleSet != 2 && !collationIsC();
+#ifdef USE_ICU_APPLE
+    return FALSE;
+#else
+    return TRUE;
+#endif
+}
+
+/* Caller has to manage the R_alloc stack */
+static SEXP makeCollationKey(SEXP a)
+{
+    if (collator == NULL)
+	return collationKeyXfrm(translateChar(a));
+#ifdef USE_ICU_APPLE
+    return NULL;
+#else
+    /* ucol_nextSortKeyPart works on an iterator, so the string need
+       not be converted to UTF-16 first */
+    UCharIterator aIter;
+    const char *as = translateCharUTF8(a);
+    int32_t len = (int32_t) strlen(as), size = 2 * len + 16, used = 0;
+    uint32_t state[2] = {0, 0};
+    uint8_t *buf = (uint8_t *) R_alloc(size, 1);
+    uiter_setUTF8(&aIter, as, len);
+    for(;;) {
+	UErrorCode status = U_ZERO_ERROR;
+	used += ucol_nextSortKeyPart(collator, &aIter, state, buf + used,
+				     size - used, &status);
+	if (U_FAILURE(status)) return NULL;
+	if (used < size) break;
+	uint8_t *nbuf = (uint8_t *) R_alloc(2 * size, 1);
+	memcpy(nbuf, buf, size);
+	buf = nbuf;
+	size *= 2;
+    }
+    return collationKeyBytes((const char *) buf, used);
+#endif
+}
+
 #else /* not USE_ICU */
 
 attribute_hidden SEXP do_ICUset(SEXP call, SEXP op, SEXP args, SEXP rho)
@@ -2562,7 +2655,10 @@ attribute_hidden SEXP do_ICUget(SEXP call, SEXP op, SEXP args, SEXP rho)
     return mkString("ICU not in use");
 }
 
-attribute_hidden void resetICUcollator(Rboolean disable) {}
+attribute_hidden void resetICUcollator(Rboolean disable)
+{
+    R_resetCollationKeys();
+}
 
 # ifdef Win32
 
@@ -2583,6 +2679,17 @@ int Scollate(SEXP a, SEXP b)
 	return strcoll(translateChar(a), translateChar(b));
 }
 
+/* the wide-character collation used for UTF-8 strings has no keys */
+static Rboolean collationHasKeys(void)
+{
+    return FALSE;
+}
+
+static SEXP makeCollationKey(SEXP a)
+{
+    return NULL;
+}
+
 # else
 attribute_hidden
 int Scollate(SEXP a, SEXP b)
@@ -2590,9 +2697,136 @@ int Scollate(SEXP a, SEXP b)
     return strcoll(translateChar(a), translateChar(b));
 }
 
+static Rboolean collationHasKeys(void)
+{
+    return !collationIsC();
+}
+
+static SEXP makeCollationKey(SEXP a)
+{
+    return collationKeyXfrm(translateChar(a));
+}
+
 # endif
 #endif
 
+/* The cache is an open-addressing hash table (linear probing) of
+   (CHARSXP, key) pairs keyed by the CHARSXP address.  It is doubled in
+   size when half full, up to 2^CKEY_MAX_BITS entries, and then emptied
+   when full. */
+#define CKEY_MIN_BITS 12
+#define CKEY_MAX_BITS 20
+#define CKEY_HASH(a, bits) ((R_xlen_t) ((((uint64_t) (uintptr_t) (a)) >> 3) * \
+				 0x9E3779B97F4A7C15ULL >> (64 - (bits))))
+
+static SEXP CollationKeyCache = NULL;
+static int ckeyBits, ckeyCount, ckeyUseful = -1;
+
+attribute_hidden void R_resetCollationKeys(void)
+{
+    if (CollationKeyCache) {
+	R_ReleaseObject(CollationKeyCache);
+	CollationKeyCache = NULL;
+    }
+    ckeyUseful = -1;
+}
+
+/* the slot for a: either holding a or empty */
+static R_INLINE R_xlen_t ckeySlot(SEXP cache, int bits, SEXP a)
+{
+    R_xlen_t mask = ((R_xlen_t) 1 << bits) - 1, h = CKEY_HASH(a, bits);
+    SEXP e;
+    while ((e = VECTOR_ELT(cache, 2 * h)) != a && e != R_NilValue)
+	h = (h + 1) & mask;
+    return h;
+}
+
+/* allocate a cache with 2^bits entries, keeping those of the old one
+   if 'keep' is true */
+static void ckeyAllocCache(int bits, Rboolean keep)
+{
+    SEXP old = CollationKeyCache;
+    SEXP cache = allocVector(VECSXP, (R_xlen_t) 2 << bits);
+    R_PreserveObject(cache);
+    ckeyCount = 0;
+    if (old) {
+	if (keep)
+	    for (R_xlen_t i = 0; i < XLENGTH(old); i += 2) {
+		SEXP a = VECTOR_ELT(old, i);
+		if (a != R_NilValue) {
+		    R_xlen_t h = 2 * ckeySlot(cache, bits, a);
+		    SET_VECTOR_ELT(cache, h, a);
+		    SET_VECTOR_ELT(cache, h + 1, VECTOR_ELT(old, i + 1));
+		    ckeyCount++;
+		}
+	    }
+	R_ReleaseObject(old);
+    }
+    CollationKeyCache = cache;
+    ckeyBits = bits;
+}
+
+/* Whether R_CollationKey() can give keys for the current collation */
+attribute_hidden Rboolean R_useCollationKeys(void)
+{
+    if (!R_CollationKeys) return FALSE;
+    if (ckeyUseful < 0) ckeyUseful = collationHasKeys();
+    return ckeyUseful;
+}
+
+/* The key of a non-NA CHARSXP, or R_NilValue if it has none (keys are
+   not used for the collation in use or the string cannot be collated),
+   when the caller should use Scollate(). */
+attribute_hidden SEXP R_CollationKey(SEXP a)
+{
+    if (!R_useCollationKeys()) return R_NilValue;
+    if (CollationKeyCache == NULL) ckeyAllocCache(CKEY_MIN_BITS, FALSE);
+
+    R_xlen_t h = ckeySlot(CollationKeyCache, ckeyBits, a);
+    if (VECTOR_ELT(CollationKeyCache, 2 * h) == a)
+	return VECTOR_ELT(CollationKeyCache, 2 * h + 1);
+
+    const void *vmax = vmaxget();
+    int errsv = errno;
+    errno = 0; /* translation failures are reported via errno */
+    SEXP key = makeCollationKey(a);
+    vmaxset(vmax);
+    /* failures are cached too, as R_NilValue, and leave errno set */
+    if (key == NULL || errno) key = R_NilValue;
+    else errno = errsv;
+    if (ckeyCount >= (1 << (ckeyBits - 1))) {
+	PROTECT(key);
+	if (ckeyBits < CKEY_MAX_BITS) ckeyAllocCache(ckeyBits + 1, TRUE);
+	else ckeyAllocCache(ckeyBits, FALSE);
+	UNPROTECT(1);
+	h = ckeySlot(CollationKeyCache, ckeyBits, a);
+    }
+    SET_VECTOR_ELT(CollationKeyCache, 2 * h, a);
+    SET_VECTOR_ELT(CollationKeyCache, 2 * h + 1, key);
+    ckeyCount++;
+    return key;
+}
+
+attribute_hidden int R_CollationKeyCmp(SEXP ka, SEXP kb)
+{
+    R_xlen_t la = XLENGTH(ka), lb = XLENGTH(kb);
+    int c = memcmp(RAW(ka), RAW(kb), la < lb ? la : lb);
+    if (c) return c;
+    return (la > lb) - (la < lb);
+}
+
+/* Scollate() via the cached keys, falling back to Scollate() when
+   there are none */
+attribute_hidden int ScollateKeys(SEXP a, SEXP b)
+{
+    SEXP ka = PROTECT(R_CollationKey(a));
+    SEXP kb = R_CollationKey(b);
+    UNPROTECT(1);
+    if (ka == R_NilValue || kb == R_NilValue)
+	return Scollate(a, b);
+    return R_CollationKeyCmp(ka, kb);
+}
+
 #include <lzma.h>
 
 attribute_hidden SEXP do_crc64(SEXP call, SEXP op, SEXP args, SEXP rho)
@@ -2727,16 +2961,31 @@ attribute_hidden SEXP do_findinterval(SEXP call, SEXP op, SEXP args, SEXP rho)
     if (si == NA_INTEGER)
 	error(_("invalid '%s' argument"), "all.inside");
     SEXP ans = allocVector(INTSXP, nx);
-    double *rxt = REAL(xt), *rx = REAL(x);
+    double *rxt = REAL(xt);
+    int *pa = INTEGER0(ans);
     int ii = 1;
-    for(int i = 0; i < nx; i++) {
+    /* findInterval2() starts its search from the previous interval, so
+       for x known to be sorted increasingly, e.g. by sort(), this is a
+       merge of x and xt; neither NAs nor a NA-reset hint need handling
+       then.  x is read by region to keep ALTREP sequences compact. */
+    if (KNOWN_INCR(REAL_IS_SORTED(x)) && REAL_NO_NA(x)) {
+	int mfl;
+	ITERATE_BY_REGION(x, rx, idx, nb, double, REAL, {
+		for (R_xlen_t j = 0; j < nb; j++)
+		    pa[idx + j] = ii =
+			findInterval2(rxt, n, rx[j], sr, si, lO, ii, &mfl);
+	    });
+	return ans;
+    }
+    double *rx = REAL(x);
+    for(R_xlen_t i = 0; i < nx; i++) {
 	if (ISNAN(rx[i]))
 	    ii = NA_INTEGER;
 	else {
 	    int mfl;
 	    ii = findInterval2(rxt, n, rx[i], sr, si, lO, ii, &mfl); // -> ../appl/interv.c
 	}
-	INTEGER(ans)[i] = ii;
+	pa[i] = ii;
     }
     return ans;
 }
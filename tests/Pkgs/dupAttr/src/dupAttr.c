@@ -0,0 +1,20 @@
+#include <Rinternals.h>
+
+/* A deep copy is owned by the caller, so its attribute values may be
+   modified in place as C code often does. */
+SEXP dup_modify(SEXP x)
+{
+    SEXP y = PROTECT(duplicate(x));
+    for (SEXP a = ATTRIB(y); a != R_NilValue; a = CDR(a)) {
+	SEXP v = CAR(a);
+	if (XLENGTH(v) == 0) continue;
+	switch (TYPEOF(v)) {
+	case STRSXP: SET_STRING_ELT(v, 0, mkChar("changed")); break;
+	case INTSXP: INTEGER(v)[0] = -1; break;
+	case REALSXP: REAL(v)[0] = -1; break;
+	default: break;
+	}
+    }
+    UNPROTECT(1);
+    return y;
+}